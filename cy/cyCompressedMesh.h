@@ -0,0 +1,509 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyCompressedMesh.h
+//! \author Cem Yuksel
+//!
+//! \brief  Compressed in-memory storage for triangular meshes.
+//!
+//! This file includes a class that keeps a TriMesh in a compact form with
+//! quantized vertices, octahedral-encoded normals, and delta-encoded face
+//! indices. The faces are compressed in blocks that can be decoded
+//! independently, so the mesh data can be decoded on demand.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_COMPRESSED_MESH_H_INCLUDED_
+#define _CY_COMPRESSED_MESH_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyPoint.h"
+#include "cyTriMesh.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Compressed in-memory storage for triangular meshes.
+//!
+//! The vertices and the texture vertices are quantized to 16 bits per coordinate relative to
+//! their bounding boxes, so the maximum error along each axis is 1/131070 of the size of the box.
+//! The vertex normals are encoded as two 16-bit values using the octahedral mapping, which
+//! keeps the directions within about 0.03 degrees, but the decoded normals always have unit
+//! length (zero normals are decoded as +z).
+//!
+//! Zina H. Cigolle, Sam Donow, Daniel Evangelakos, Michael Mara, Morgan McGuire, and Quirin Meyer.
+//! 2014. A Survey of Efficient Representations for Independent Unit Vectors.
+//! Journal of Computer Graphics Techniques (JCGT), 3(2), 1-30.
+//!
+//! The faces are split into blocks of a fixed number of faces and the indices of each block are
+//! delta-encoded as variable-length integers. The first index of a face is encoded relative to
+//! the first index of the previous face in the block and the other two indices are encoded
+//! relative to the first index, so meshes with good locality (see TriMesh::SpatialSortVertices
+//! and TriMesh::OptimizeFaceOrder) use 3 to 4 bytes per face instead of 12. The normal and texture
+//! faces are not stored if they are the same as the faces. Each block can be decoded independently,
+//! and the bounding box of the vertices of each block is kept, so the faces can be culled and
+//! decoded on demand. The decoding of the vertices and the normals has no dependencies between
+//! them, so the loops are vectorized. Decompress decodes the whole mesh in parallel.
+
+class CompressedTriMesh
+{
+public:
+	//! The default number of faces in a block
+	static const unsigned int DEFAULT_BLOCK_FACE_COUNT = 1024;
+
+	CompressedTriMesh() : nv(0), nf(0), nvn(0), nvt(0), blockFaceCount(DEFAULT_BLOCK_FACE_COUNT)
+						, vOffset(0,0,0), vScale(0,0,0), vtOffset(0,0,0), vtScale(0,0,0) {}
+
+	//!@name Compression methods
+
+	//! Compresses the given mesh using blocks of the given number of faces, including its materials.
+	//! Smaller blocks allow finer random access to the faces, but compress slightly worse.
+	void Compress( const TriMesh &mesh, unsigned int blockFaceCount=DEFAULT_BLOCK_FACE_COUNT );
+
+	//! Decodes the whole mesh. The bounding box of the mesh is computed.
+	void Decompress( TriMesh &mesh ) const;
+
+	//! Deletes the compressed data.
+	void Clear();
+
+	//!@name Component count methods
+	unsigned int NV () const { return nv; }				//!< returns the number of vertices
+	unsigned int NF () const { return nf; }				//!< returns the number of faces
+	unsigned int NVN() const { return nvn; }			//!< returns the number of vertex normals
+	unsigned int NVT() const { return nvt; }			//!< returns the number of texture vertices
+	unsigned int NM () const { return (unsigned int) mtl.size(); }	//!< returns the number of materials
+	bool HasNormals() const { return NVN() > 0; }			//!< returns true if the mesh has vertex normals
+	bool HasTextureVertices() const { return NVT() > 0; }	//!< returns true if the mesh has texture vertices
+	size_t MemorySize() const;							//!< Returns the number of bytes used by the compressed mesh.
+
+	//!@name Material methods
+	const TriMesh::Mtl& M(int i) const { return mtl[i]; }	//!< returns the i^th material
+	int GetMaterialFaceCount(int mtlID) const { return mtlID>0 ? mcfc[mtlID]-mcfc[mtlID-1] : mcfc[0]; }	//!< Returns the number of faces associated with the given material ID.
+	int GetMaterialFirstFace(int mtlID) const { return mtlID>0 ? mcfc[mtlID-1] : 0; }	//!< Returns the first face index associated with the given material ID.
+
+	//!@name Block access methods
+	unsigned int NumBlocks() const { return ( nf + blockFaceCount - 1 ) / blockFaceCount; }	//!< Returns the number of face blocks.
+	unsigned int BlockFaceCount() const { return blockFaceCount; }							//!< Returns the number of faces in a block. The last block can have fewer faces.
+	unsigned int GetBlockFirstFace(unsigned int block) const { return block * blockFaceCount; }	//!< Returns the index of the first face of the given block.
+	unsigned int GetBlockFaceCount(unsigned int block) const { unsigned int n = nf - GetBlockFirstFace(block); return n < blockFaceCount ? n : blockFaceCount; }	//!< Returns the number of faces of the given block.
+	void GetBlockBounds( unsigned int block, Point3f &boundMin, Point3f &boundMax ) const;	//!< Returns the bounding box of the decoded vertices of the faces of the given block.
+
+	//! Decodes the faces of the given block. The faces array must have GetBlockFaceCount(block) elements.
+	void DecodeFaces      ( unsigned int block, TriMesh::TriFace *faces ) const { DecodeBlock( faceStreams[STREAM_F], block, faces ); }
+	//! Decodes the normal faces of the given block. The faces array must have GetBlockFaceCount(block) elements.
+	//! Does nothing if the mesh has no vertex normals.
+	void DecodeNormalFaces( unsigned int block, TriMesh::TriFace *faces ) const { if ( nvn > 0 ) DecodeBlock( faceStreams[ faceStreams[STREAM_FN].sameAsFaces ? STREAM_F : STREAM_FN ], block, faces ); }
+	//! Decodes the texture faces of the given block. The faces array must have GetBlockFaceCount(block) elements.
+	//! Does nothing if the mesh has no texture vertices.
+	void DecodeTexFaces   ( unsigned int block, TriMesh::TriFace *faces ) const { if ( nvt > 0 ) DecodeBlock( faceStreams[ faceStreams[STREAM_FT].sameAsFaces ? STREAM_F : STREAM_FT ], block, faces ); }
+
+	//!@name Vertex access methods
+	Point3f V (unsigned int i) const { return DecodePoint( &qv [i*3], vOffset,  vScale  ); }	//!< Decodes the i^th vertex
+	Point3f VN(unsigned int i) const { return DecodeNormal( qvn[i*2], qvn[i*2+1] ); }		//!< Decodes the i^th vertex normal
+	Point3f VT(unsigned int i) const { return DecodePoint( &qvt[i*3], vtOffset, vtScale ); }	//!< Decodes the i^th texture vertex
+	void DecodeVertices( unsigned int first, unsigned int count, Point3f *verts     ) const { DecodePoints( qv .data(), vOffset,  vScale,  first, count, verts ); }	//!< Decodes the given number of vertices starting with the given vertex.
+	void DecodeTexVerts( unsigned int first, unsigned int count, Point3f *texVerts  ) const { DecodePoints( qvt.data(), vtOffset, vtScale, first, count, texVerts ); }	//!< Decodes the given number of texture vertices starting with the given texture vertex.
+	void DecodeNormals ( unsigned int first, unsigned int count, Point3f *normals   ) const;	//!< Decodes the given number of vertex normals starting with the given vertex normal.
+
+private:
+	//! The delta-encoded indices of a face array
+	struct FaceStream
+	{
+		std::vector<uint8_t> data;			// variable-length integers of all blocks
+		std::vector<size_t>  blockStart;	// the first byte of each block, followed by the size of the data
+		bool sameAsFaces;					// the faces are the same as the vertex faces, so they are not stored
+		FaceStream() : sameAsFaces(false) {}
+	};
+	enum { STREAM_F, STREAM_FN, STREAM_FT, STREAM_COUNT };
+
+	unsigned int nv, nf, nvn, nvt;
+	unsigned int blockFaceCount;
+	Point3f vOffset,  vScale;				// decoded vertex = offset + quantized vertex * scale
+	Point3f vtOffset, vtScale;
+	std::vector<uint16_t> qv;				// quantized vertices
+	std::vector<uint16_t> qvt;				// quantized texture vertices
+	std::vector<int16_t>  qvn;				// octahedral-encoded vertex normals
+	std::vector<uint16_t> blockBounds;		// quantized bounding box of each block (min and max)
+	FaceStream faceStreams[STREAM_COUNT];
+	std::vector<TriMesh::Mtl> mtl;
+	std::vector<int> mcfc;					// material cumulative face count
+
+	static const unsigned int QUANT_MAX  = 65535;	// the largest quantized coordinate
+	static const int          OCT_MAX    = 32767;	// the largest octahedral coordinate
+
+	static void Quantize( const Point3f *points, unsigned int count, Point3f &offset, Point3f &scale, std::vector<uint16_t> &q );
+	static void EncodeNormals( const Point3f *normals, unsigned int count, std::vector<int16_t> &q );
+	static void DecodePoints( const uint16_t *q, const Point3f &offset, const Point3f &scale, unsigned int first, unsigned int count, Point3f *points );
+	static Point3f DecodePoint( const uint16_t *q, const Point3f &offset, const Point3f &scale ) { return Point3f( offset.x + float(q[0])*scale.x, offset.y + float(q[1])*scale.y, offset.z + float(q[2])*scale.z ); }
+	static Point3f DecodeNormal( int16_t qx, int16_t qy );
+
+	void EncodeStream( FaceStream &stream, const TriMesh::TriFace *faces );
+	void DecodeBlock( const FaceStream &stream, unsigned int block, TriMesh::TriFace *faces ) const;
+
+	static unsigned int ZigZag  ( uint32_t a, uint32_t b ) { int32_t d = int32_t(a-b); return ( uint32_t(d) << 1 ) ^ uint32_t( d >> 31 ); }
+	static unsigned int UnZigZag( uint32_t b, uint32_t z ) { return b + ( ( z >> 1 ) ^ ( 0u - ( z & 1 ) ) ); }
+	static size_t VarIntSize( uint32_t z ) { size_t n=1; while ( z >= 0x80 ) { z >>= 7; n++; } return n; }
+	static uint8_t* WriteVarInt( uint8_t *p, uint32_t z ) { while ( z >= 0x80 ) { *p++ = uint8_t( z | 0x80 ); z >>= 7; } *p++ = uint8_t(z); return p; }
+	static const uint8_t* ReadVarInt( const uint8_t *p, uint32_t &z )
+	{
+		z = *p++;
+		if ( z < 0x80 ) return p;
+		z &= 0x7F;
+		for ( int shift=7; ; shift+=7 ) {
+			uint32_t b = *p++;
+			z |= ( b & 0x7F ) << shift;
+			if ( b < 0x80 ) return p;
+		}
+	}
+};
+
+//-------------------------------------------------------------------------------
+
+inline void CompressedTriMesh::Clear()
+{
+	nv = nf = nvn = nvt = 0;
+	vOffset.Zero(); vScale.Zero(); vtOffset.Zero(); vtScale.Zero();
+	std::vector<uint16_t>().swap(qv);
+	std::vector<uint16_t>().swap(qvt);
+	std::vector<int16_t> ().swap(qvn);
+	std::vector<uint16_t>().swap(blockBounds);
+	for ( int s=0; s<STREAM_COUNT; s++ ) faceStreams[s] = FaceStream();
+	std::vector<TriMesh::Mtl>().swap(mtl);
+	std::vector<int>().swap(mcfc);
+}
+
+inline size_t CompressedTriMesh::MemorySize() const
+{
+	size_t size = sizeof(*this);
+	size += qv.capacity()*sizeof(uint16_t) + qvt.capacity()*sizeof(uint16_t) + qvn.capacity()*sizeof(int16_t);
+	size += blockBounds.capacity()*sizeof(uint16_t);
+	for ( int s=0; s<STREAM_COUNT; s++ ) size += faceStreams[s].data.capacity() + faceStreams[s].blockStart.capacity()*sizeof(size_t);
+	size += mtl.capacity()*sizeof(TriMesh::Mtl) + mcfc.capacity()*sizeof(int);
+	return size;
+}
+
+//-------------------------------------------------------------------------------
+
+inline void CompressedTriMesh::Compress( const TriMesh &mesh, unsigned int faceCount )
+{
+	Clear();
+	blockFaceCount = faceCount > 0 ? faceCount : 1;
+	nv  = mesh.NV();
+	nf  = mesh.NF();
+	nvn = mesh.NVN();
+	nvt = mesh.NVT();
+
+	if ( nv  > 0 ) Quantize( &mesh.V(0), nv, vOffset, vScale, qv );
+	if ( nvt > 0 ) Quantize( &mesh.VT(0), nvt, vtOffset, vtScale, qvt );
+	if ( nvn > 0 ) EncodeNormals( &mesh.VN(0), nvn, qvn );
+
+	if ( nf > 0 ) {
+		const TriMesh::TriFace *f = &mesh.F(0);
+		EncodeStream( faceStreams[STREAM_F], f );
+		const TriMesh::TriFace *faces[STREAM_COUNT] = { f, nvn > 0 ? &mesh.FN(0) : NULL, nvt > 0 ? &mesh.FT(0) : NULL };
+		for ( int s=STREAM_FN; s<STREAM_COUNT; s++ ) {
+			if ( !faces[s] ) continue;
+			if ( memcmp( faces[s], f, sizeof(TriMesh::TriFace)*nf ) == 0 ) faceStreams[s].sameAsFaces = true;
+			else EncodeStream( faceStreams[s], faces[s] );
+		}
+
+		// The bounds of each block are kept as quantized vertices, so they decode to the exact bounds of the decoded vertices.
+		unsigned int blockCount = NumBlocks();
+		blockBounds.resize( size_t(blockCount)*6 );
+		ParallelForRanges( 0u, blockCount, ParallelRangeCount(nf), [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			for ( unsigned int b=rangeBegin; b<rangeEnd; b++ ) {
+				uint16_t *bounds = &blockBounds[ size_t(b)*6 ];
+				for ( int j=0; j<3; j++ ) { bounds[j] = uint16_t(QUANT_MAX); bounds[j+3] = 0; }
+				unsigned int faceEnd = GetBlockFirstFace(b) + GetBlockFaceCount(b);
+				for ( unsigned int i=GetBlockFirstFace(b); i<faceEnd; i++ ) {
+					for ( int k=0; k<3; k++ ) {
+						unsigned int vi = f[i].v[k];
+						if ( vi >= nv ) continue;
+						const uint16_t *q = &qv[ size_t(vi)*3 ];
+						for ( int j=0; j<3; j++ ) {
+							if ( q[j] < bounds[j]   ) bounds[j]   = q[j];
+							if ( q[j] > bounds[j+3] ) bounds[j+3] = q[j];
+						}
+					}
+				}
+			}
+		} );
+	}
+
+	unsigned int nm = mesh.NM();
+	mtl.resize( nm );
+	mcfc.resize( nm );
+	for ( unsigned int i=0; i<nm; i++ ) {
+		mtl[i]  = mesh.M(i);
+		mcfc[i] = mesh.GetMaterialFirstFace(i) + mesh.GetMaterialFaceCount(i);
+	}
+}
+
+inline void CompressedTriMesh::Decompress( TriMesh &mesh ) const
+{
+	mesh.Clear();
+	mesh.SetNumVertex( nv );
+	mesh.SetNumFaces( nf );
+	if ( nvn > 0 ) mesh.SetNumNormals( nvn );
+	if ( nvt > 0 ) mesh.SetNumTexVerts( nvt );
+
+	if ( nv  > 0 ) DecodeVertices( 0, nv,  &mesh.V(0)  );
+	if ( nvn > 0 ) DecodeNormals ( 0, nvn, &mesh.VN(0) );
+	if ( nvt > 0 ) DecodeTexVerts( 0, nvt, &mesh.VT(0) );
+
+	if ( nf > 0 ) {
+		TriMesh::TriFace *f  = &mesh.F(0);
+		TriMesh::TriFace *fn = nvn > 0 ? &mesh.FN(0) : NULL;
+		TriMesh::TriFace *ft = nvt > 0 ? &mesh.FT(0) : NULL;
+		ParallelForRanges( 0u, NumBlocks(), ParallelRangeCount(nf), [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			for ( unsigned int b=rangeBegin; b<rangeEnd; b++ ) {
+				unsigned int first = GetBlockFirstFace(b);
+				DecodeFaces( b, f + first );
+				if ( fn ) {
+					if ( faceStreams[STREAM_FN].sameAsFaces ) memcpy( fn + first, f + first, sizeof(TriMesh::TriFace)*GetBlockFaceCount(b) );
+					else DecodeBlock( faceStreams[STREAM_FN], b, fn + first );
+				}
+				if ( ft ) {
+					if ( faceStreams[STREAM_FT].sameAsFaces ) memcpy( ft + first, f + first, sizeof(TriMesh::TriFace)*GetBlockFaceCount(b) );
+					else DecodeBlock( faceStreams[STREAM_FT], b, ft + first );
+				}
+			}
+		} );
+	}
+
+	unsigned int nm = NM();
+	if ( nm > 0 ) {
+		mesh.SetNumMtls( nm );
+		for ( unsigned int i=0; i<nm; i++ ) {
+			mesh.M(i) = mtl[i];
+			mesh.SetMaterialCumulativeFaceCount( i, mcfc[i] );
+		}
+	}
+	mesh.ComputeBoundingBox();
+}
+
+//-------------------------------------------------------------------------------
+
+inline void CompressedTriMesh::GetBlockBounds( unsigned int block, Point3f &boundMin, Point3f &boundMax ) const
+{
+	const uint16_t *bounds = &blockBounds[ size_t(block)*6 ];
+	boundMin = DecodePoint( bounds,     vOffset, vScale );
+	boundMax = DecodePoint( bounds + 3, vOffset, vScale );
+}
+
+inline void CompressedTriMesh::Quantize( const Point3f *points, unsigned int count, Point3f &offset, Point3f &scale, std::vector<uint16_t> &q )
+{
+	Point3f boundMin = points[0], boundMax = points[0];
+	for ( unsigned int i=1; i<count; i++ ) {
+		for ( int j=0; j<3; j++ ) {
+			if ( points[i][j] < boundMin[j] ) boundMin[j] = points[i][j];
+			if ( points[i][j] > boundMax[j] ) boundMax[j] = points[i][j];
+		}
+	}
+	Point3f invScale;
+	offset = boundMin;
+	for ( int j=0; j<3; j++ ) {
+		float size = boundMax[j] - boundMin[j];
+		scale[j]    = size / float(QUANT_MAX);
+		invScale[j] = size > 0 ? float(QUANT_MAX) / size : 0.0f;
+	}
+	q.resize( size_t(count)*3 );
+	ParallelFor( 0u, count, [&]( unsigned int i ) {
+		for ( int j=0; j<3; j++ ) {
+			float s = ( points[i][j] - offset[j] ) * invScale[j] + 0.5f;
+			q[ size_t(i)*3 + j ] = uint16_t( s <= 0 ? 0 : ( s >= float(QUANT_MAX) ? QUANT_MAX : (unsigned int) s ) );
+		}
+	} );
+}
+
+inline void CompressedTriMesh::DecodePoints( const uint16_t *q, const Point3f &offset, const Point3f &scale, unsigned int first, unsigned int count, Point3f *points )
+{
+	// The coordinates of a block of 16 points are decoded as 48 independent lanes, so the loop is
+	// vectorized without gathering the coordinates. Lane j decodes axis j%3.
+	const unsigned int BLOCK = 16, LANES = BLOCK*3;
+	float laneOffset[LANES], laneScale[LANES];
+	for ( unsigned int j=0; j<LANES; j++ ) { laneOffset[j] = offset[j%3]; laneScale[j] = scale[j%3]; }
+	const uint16_t *src = q + size_t(first)*3;
+	float *dst = &points[0].x;
+	ParallelForRanges( 0u, count, ParallelRangeCount(count), [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+		size_t i = size_t(rangeBegin)*3, end = size_t(rangeEnd)*3;
+		for ( ; i+LANES<=end; i+=LANES ) {
+			_CY_IVDEP_FOR ( unsigned int j=0; j<LANES; j++ ) dst[i+j] = laneOffset[j] + float(src[i+j]) * laneScale[j];
+		}
+		for ( unsigned int j=0; i<end; i++, j++ ) dst[i] = laneOffset[j] + float(src[i]) * laneScale[j];
+	} );
+}
+
+//-------------------------------------------------------------------------------
+
+inline void CompressedTriMesh::EncodeNormals( const Point3f *normals, unsigned int count, std::vector<int16_t> &q )
+{
+	q.resize( size_t(count)*2 );
+	ParallelFor( 0u, count, [&]( unsigned int i ) {
+		const Point3f &n = normals[i];
+		float len = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		int16_t *e = &q[ size_t(i)*2 ];
+		if ( len == 0 ) { e[0] = e[1] = 0; return; }
+		float u = n.x / len, v = n.y / len;
+		if ( n.z < 0 ) {
+			float ou = u;
+			u = ( 1 - fabsf(v)  ) * ( u >= 0 ? 1.0f : -1.0f );
+			v = ( 1 - fabsf(ou) ) * ( v >= 0 ? 1.0f : -1.0f );
+		}
+		// Among the four nearest quantized values, pick the one that decodes closest to the normal.
+		Point3f dir = n.GetNormalized();
+		float fu = floorf( u * OCT_MAX ), fv = floorf( v * OCT_MAX );
+		float best = -2;
+		for ( int k=0; k<4; k++ ) {
+			float cu = fu + float(k&1), cv = fv + float(k>>1);
+			if ( cu < -OCT_MAX || cu > OCT_MAX || cv < -OCT_MAX || cv > OCT_MAX ) continue;
+			float d = DecodeNormal( int16_t(cu), int16_t(cv) ).Dot( dir );
+			if ( d > best ) { best = d; e[0] = int16_t(cu); e[1] = int16_t(cv); }
+		}
+	} );
+}
+
+inline Point3f CompressedTriMesh::DecodeNormal( int16_t qx, int16_t qy )
+{
+	float x = float(qx) * ( 1.0f / OCT_MAX );
+	float y = float(qy) * ( 1.0f / OCT_MAX );
+	float z = 1 - fabsf(x) - fabsf(y);
+	float t = z < 0 ? -z : 0;
+	x += x >= 0 ? -t : t;
+	y += y >= 0 ? -t : t;
+	float s = 1 / cySqrt( x*x + y*y + z*z );
+	return Point3f( x*s, y*s, z*s );
+}
+
+inline void CompressedTriMesh::DecodeNormals( unsigned int first, unsigned int count, Point3f *normals ) const
+{
+	// The normals are decoded in blocks of 16 into separate arrays of x, y, and z, so the loop is
+	// vectorized, and then the blocks are interleaved.
+	const unsigned int BLOCK = 16;
+	const int16_t *src = qvn.data() + size_t(first)*2;
+	ParallelForRanges( 0u, count, ParallelRangeCount(count), [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+		float x[BLOCK], y[BLOCK], z[BLOCK];
+		int16_t tail[BLOCK*2];
+		for ( unsigned int b=rangeBegin; b<rangeEnd; b+=BLOCK ) {
+			unsigned int n = rangeEnd - b < BLOCK ? rangeEnd - b : BLOCK;
+			const int16_t *e = src + size_t(b)*2;
+			if ( n < BLOCK ) {	// the last block is decoded from a copy, so that it does not read past the end
+				memset( tail, 0, sizeof(tail) );
+				memcpy( tail, e, n*2*sizeof(int16_t) );
+				e = tail;
+			}
+			_CY_IVDEP_FOR ( unsigned int j=0; j<BLOCK; j++ ) {
+				float u = float(e[j*2  ]) * ( 1.0f / OCT_MAX );
+				float v = float(e[j*2+1]) * ( 1.0f / OCT_MAX );
+				float w = 1 - fabsf(u) - fabsf(v);
+				float t = w < 0 ? -w : 0;
+				u += u >= 0 ? -t : t;
+				v += v >= 0 ? -t : t;
+				float s = 1 / cySqrt( u*u + v*v + w*w );
+				x[j] = u*s;
+				y[j] = v*s;
+				z[j] = w*s;
+			}
+			for ( unsigned int j=0; j<n; j++ ) normals[b+j].Set( x[j], y[j], z[j] );
+		}
+	} );
+}
+
+//-------------------------------------------------------------------------------
+
+inline void CompressedTriMesh::EncodeStream( FaceStream &stream, const TriMesh::TriFace *faces )
+{
+	// The blocks are encoded in parallel in two passes: the first pass computes the size of each block
+	// and the second pass writes the blocks after their starting bytes are known.
+	unsigned int blockCount = NumBlocks();
+	stream.blockStart.resize( size_t(blockCount) + 1 );
+	int rangeCount = ParallelRangeCount(nf);
+	ParallelForRanges( 0u, blockCount, rangeCount, [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+		for ( unsigned int b=rangeBegin; b<rangeEnd; b++ ) {
+			const TriMesh::TriFace *f = faces + GetBlockFirstFace(b);
+			unsigned int n = GetBlockFaceCount(b);
+			size_t size = 0;
+			uint32_t prev = 0;
+			for ( unsigned int i=0; i<n; i++ ) {
+				size += VarIntSize( ZigZag( f[i].v[0], prev ) ) + VarIntSize( ZigZag( f[i].v[1], f[i].v[0] ) ) + VarIntSize( ZigZag( f[i].v[2], f[i].v[0] ) );
+				prev = f[i].v[0];
+			}
+			stream.blockStart[b+1] = size;
+		}
+	} );
+	stream.blockStart[0] = 0;
+	for ( unsigned int b=0; b<blockCount; b++ ) stream.blockStart[b+1] += stream.blockStart[b];
+	stream.data.resize( stream.blockStart[blockCount] );
+	ParallelForRanges( 0u, blockCount, rangeCount, [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+		for ( unsigned int b=rangeBegin; b<rangeEnd; b++ ) {
+			const TriMesh::TriFace *f = faces + GetBlockFirstFace(b);
+			unsigned int n = GetBlockFaceCount(b);
+			uint8_t *p = stream.data.data() + stream.blockStart[b];
+			uint32_t prev = 0;
+			for ( unsigned int i=0; i<n; i++ ) {
+				p = WriteVarInt( p, ZigZag( f[i].v[0], prev ) );
+				p = WriteVarInt( p, ZigZag( f[i].v[1], f[i].v[0] ) );
+				p = WriteVarInt( p, ZigZag( f[i].v[2], f[i].v[0] ) );
+				prev = f[i].v[0];
+			}
+		}
+	} );
+
+}
+
+inline void CompressedTriMesh::DecodeBlock( const FaceStream &stream, unsigned int block, TriMesh::TriFace *faces ) const
+{
+	const uint8_t *p = stream.data.data() + stream.blockStart[block];
+	unsigned int n = GetBlockFaceCount(block);
+	uint32_t prev = 0;
+	for ( unsigned int i=0; i<n; i++ ) {
+		uint32_t z0, z1, z2;
+		p = ReadVarInt( p, z0 );
+		p = ReadVarInt( p, z1 );
+		p = ReadVarInt( p, z2 );
+		prev = UnZigZag( prev, z0 );
+		faces[i].v[0] = prev;
+		faces[i].v[1] = UnZigZag( prev, z1 );
+		faces[i].v[2] = UnZigZag( prev, z2 );
+	}
+}
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::CompressedTriMesh cyCompressedTriMesh;	//!< Compressed in-memory storage for triangular meshes
+
+//-------------------------------------------------------------------------------
+
+#endif
@@ -42,12 +42,26 @@
 #define _CY_CORE_MEMCPY_LIMIT 256
 #endif
 
+#ifndef _CY_CORE_THREAD_COUNT
+#define _CY_CORE_THREAD_COUNT 0		// zero uses all hardware threads
+#endif
+
+#ifndef _CY_CORE_PARALLEL_MIN_ITEMS
+#define _CY_CORE_PARALLEL_MIN_ITEMS 1024
+#endif
+
 //-------------------------------------------------------------------------------
 
 #include <math.h>
 #include <string.h>
+#include <cstddef>
 #include <stdint.h>
 #include <type_traits>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
 
 //-------------------------------------------------------------------------------
 namespace cy {
@@ -64,6 +78,7 @@ template<typename TYPE> inline TYPE cyTan ( TYPE a ) { return (TYPE) ::tan (a);
 template<typename TYPE> inline TYPE cyAbs ( TYPE a ) { return (TYPE) ::abs (a); }
 template<typename TYPE> inline TYPE cySqrt( TYPE a ) { return (TYPE) ::sqrt(a); }
 template<typename TYPE> inline TYPE cyPow ( TYPE a, TYPE e ) { return (TYPE) ::pow(a,e); }
+template<typename TYPE> inline TYPE cyFloor( TYPE a ) { return (TYPE) ::floor(a); }
 template<typename TYPE> inline TYPE cyPi  () { return TYPE(3.141592653589793238462643383279502884197169); }
 
 template<> inline float cySin <float>( float a ) { return ::sinf (a); }
@@ -72,6 +87,7 @@ template<> inline float cyTan <float>( float a ) { return ::tanf (a); }
 template<> inline float cyAbs <float>( float a ) { return ::fabsf(a); }
 template<> inline float cySqrt<float>( float a ) { return ::sqrtf(a); }
 template<> inline float cyPow <float>( float a, float e ) { return ::powf(a,e); }
+template<> inline float cyFloor<float>( float a ) { return ::floorf(a); }
 
 template<> inline double cyAbs ( double a ) { return ::fabs(a); }
 
@@ -94,13 +110,123 @@ template<> inline double cyAbs ( double a ) { return ::fabs(a); }
 
 #ifdef _MSC_VER
 # define _CY_IVDEP loop( ivdep )
+# define _CY_IVDEP_FOR __pragma(_CY_IVDEP) for
 #elif defined __GNUC__
-# define _CY_IVDEP GLL ivdep
+# define _CY_IVDEP GCC ivdep
+# define _CY_IVDEP_FOR _Pragma("GCC ivdep") for
 #else
 # define _CY_IVDEP ivdep
+# define _CY_IVDEP_FOR for
 #endif
 
-#define _CY_IVDEP_FOR __pragma(_CY_IVDEP) for
+//////////////////////////////////////////////////////////////////////////
+// Parallel Loops
+
+//!@name Parallel loop functions
+
+//! Returns the number of threads used by the parallel loop functions.
+inline int ParallelThreadCount()
+{
+	int n = _CY_CORE_THREAD_COUNT;
+	if ( n <= 0 ) n = (int) std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+//! Returns a reference to a per-thread flag that is set while the thread runs a parallel loop body.
+//! Parallel loops that are started within the body of another parallel loop run serially.
+inline bool& ParallelIsNested() { static thread_local bool nested = false; return nested; }
+
+//! Returns the number of ranges that ParallelForRanges should use for the given number of items.
+//! The returned value depends on the number of threads, so it should not be used for
+//! computations that must produce the same results regardless of the thread count.
+inline int ParallelRangeCount( size_t itemCount )
+{
+	size_t n = itemCount / _CY_CORE_PARALLEL_MIN_ITEMS;
+	size_t maxRanges = size_t(ParallelThreadCount()) * 4;
+	if ( n > maxRanges ) n = maxRanges;
+	return n > 0 ? (int) n : 1;
+}
+
+//! Splits the items between begin and end into rangeCount consecutive ranges of (almost) equal size
+//! and calls the body function for each range using multiple threads. The body function must be
+//! in the following form:
+//!
+//! void body( int rangeIndex, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd )
+//!
+//! The ranges are processed in arbitrary order, but range boundaries only depend on rangeCount.
+template <typename SIZE_TYPE, typename BODY>
+inline void ParallelForRanges( SIZE_TYPE begin, SIZE_TYPE end, int rangeCount, BODY body )
+{
+	if ( end <= begin || rangeCount <= 0 ) return;
+	SIZE_TYPE n = end - begin;
+	if ( SIZE_TYPE(rangeCount) > n ) rangeCount = (int) n;
+	auto RangeStart = [begin,n,rangeCount]( int r ) { return begin + SIZE_TYPE( uint64_t(n) * uint64_t(r) / uint64_t(rangeCount) ); };
+	int threadCount = ParallelIsNested() ? 1 : ParallelThreadCount();
+	if ( threadCount > rangeCount ) threadCount = rangeCount;
+	if ( threadCount <= 1 ) {
+		for ( int r=0; r<rangeCount; r++ ) body( r, RangeStart(r), RangeStart(r+1) );
+		return;
+	}
+	std::atomic<int> nextRange(0);
+	auto Worker = [&]() {
+		bool &nested = ParallelIsNested();
+		bool wasNested = nested;
+		nested = true;
+		for ( int r = nextRange++; r < rangeCount; r = nextRange++ ) body( r, RangeStart(r), RangeStart(r+1) );
+		nested = wasNested;
+	};
+	std::vector<std::thread> threads;
+	threads.reserve( threadCount-1 );
+	for ( int t=1; t<threadCount; t++ ) threads.emplace_back( Worker );
+	Worker();
+	for ( auto &t : threads ) t.join();
+}
+
+//! Calls the body function for each item between begin and end using multiple threads.
+//! The body function must be in the following form:
+//!
+//! void body( SIZE_TYPE i )
+template <typename SIZE_TYPE, typename BODY>
+inline void ParallelFor( SIZE_TYPE begin, SIZE_TYPE end, BODY body )
+{
+	if ( end <= begin ) return;
+	ParallelForRanges( begin, end, ParallelRangeCount(end-begin), [&body]( int, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+		for ( SIZE_TYPE i=rangeBegin; i<rangeEnd; i++ ) body(i);
+	} );
+}
+
+//! Sorts the items between begin and end using multiple threads. The ranges of the items are
+//! sorted in parallel using std::sort and then merged pairwise in parallel. Like std::sort,
+//! the order of the items that compare equal is not preserved. Therefore, the result does not
+//! depend on the number of threads only if no two items compare equal.
+template <typename ITERATOR, typename COMPARE>
+inline void ParallelSort( ITERATOR begin, ITERATOR end, COMPARE compare )
+{
+	std::ptrdiff_t n = end - begin;
+	int rangeCount = ParallelRangeCount( size_t(n) );
+	if ( rangeCount <= 1 || ParallelIsNested() ) { std::sort( begin, end, compare ); return; }
+	auto RangeStart = [begin,n,rangeCount]( int r ) { return begin + std::ptrdiff_t( uint64_t(n) * uint64_t(r) / uint64_t(rangeCount) ); };
+	ParallelForRanges( 0, rangeCount, rangeCount, [&]( int, int rangeBegin, int rangeEnd ) {
+		for ( int r=rangeBegin; r<rangeEnd; r++ ) std::sort( RangeStart(r), RangeStart(r+1), compare );
+	} );
+	for ( int width=1; width<rangeCount; width*=2 ) {
+		int mergeCount = ( rangeCount + 2*width - 1 ) / ( 2*width );
+		ParallelForRanges( 0, mergeCount, mergeCount, [&]( int, int mergeBegin, int mergeEnd ) {
+			for ( int m=mergeBegin; m<mergeEnd; m++ ) {
+				int r = m * 2 * width;
+				int rMid = r + width;
+				int rEnd = r + 2*width;
+				if ( rMid >= rangeCount ) continue;
+				if ( rEnd > rangeCount ) rEnd = rangeCount;
+				std::inplace_merge( RangeStart(r), RangeStart(rMid), RangeStart(rEnd), compare );
+			}
+		} );
+	}
+}
+
+//! Sorts the items between begin and end using multiple threads with operator <.
+template <typename ITERATOR>
+inline void ParallelSort( ITERATOR begin, ITERATOR end ) { ParallelSort( begin, end, std::less<>() ); }
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -36,8 +36,13 @@
 
 //-------------------------------------------------------------------------------
 
+#include "cyCore.h"
+#include "cyMappedFile.h"
 #include <stdio.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
 
 //-------------------------------------------------------------------------------
 namespace cy {
@@ -98,14 +103,19 @@ public:
 	const float* GetColorsArray() const { return colors; }				//!< Returns colors array (rgb color at each hair point).
 
 
+	//! Returns true if the arrays are loaded from a memory-mapped file (see LoadFromFile).
+	bool IsMemoryMapped() const { return mappedFile.IsOpen(); }
+
+
 	//////////////////////////////////////////////////////////////////////////
 	//!@name Data Access Methods
+	//! If the file is memory-mapped, these methods copy the returned array out of the read-only mapping first.
 
-	unsigned short* GetSegmentsArray() { return segments; }	//!< Returns segments array (segment count for each hair strand).
-	float* GetPointsArray() { return points; }				//!< Returns points array (xyz coordinates of each hair point).
-	float* GetThicknessArray() { return thickness; }		//!< Returns thickness array (thickness at each hair point}.
-	float* GetTransparencyArray() { return transparency; }	//!< Returns transparency array (transparency at each hair point).
-	float* GetColorsArray() { return colors; }				//!< Returns colors array (rgb color at each hair point).
+	unsigned short* GetSegmentsArray() { return Detach( segments, header.hair_count ); }			//!< Returns segments array (segment count for each hair strand).
+	float* GetPointsArray() { return Detach( points, size_t(header.point_count)*3 ); }			//!< Returns points array (xyz coordinates of each hair point).
+	float* GetThicknessArray() { return Detach( thickness, header.point_count ); }				//!< Returns thickness array (thickness at each hair point}.
+	float* GetTransparencyArray() { return Detach( transparency, header.point_count ); }		//!< Returns transparency array (transparency at each hair point).
+	float* GetColorsArray() { return Detach( colors, size_t(header.point_count)*3 ); }			//!< Returns colors array (rgb color at each hair point).
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -114,11 +124,12 @@ public:
 	//! Deletes all arrays and initializes the header data.
 	void Initialize()
 	{
-		if ( segments ) delete [] segments;
-		if ( points ) delete [] points;
-		if ( colors ) delete [] colors;
-		if ( thickness ) delete [] thickness;
-		if ( transparency ) delete [] transparency;
+		DeleteArray( segments );
+		DeleteArray( points );
+		DeleteArray( colors );
+		DeleteArray( thickness );
+		DeleteArray( transparency );
+		mappedFile.Close();
 		header.signature[0] = 'H';
 		header.signature[1] = 'A';
 		header.signature[2] = 'I';
@@ -140,7 +151,7 @@ public:
 	{
 		header.hair_count = count;
 		if ( segments ) {
-			delete [] segments;
+			DeleteArray( segments );
 			segments = new unsigned short[ header.hair_count ];
 		}
 	}
@@ -150,19 +161,19 @@ public:
 	{
 		header.point_count = count;
 		if ( points ) {
-			delete [] points;
+			DeleteArray( points );
 			points = new float[ header.point_count*3 ];
 		}
 		if ( thickness ) {
-			delete [] thickness;
+			DeleteArray( thickness );
 			thickness = new float[ header.point_count ];
 		}
 		if ( transparency ) {
-			delete [] transparency;
+			DeleteArray( transparency );
 			transparency = new float[ header.point_count ];
 		}
 		if ( colors ) {
-			delete [] colors;
+			DeleteArray( colors );
 			colors = new float[ header.point_count*3 ];
 		}
 	}
@@ -174,15 +185,15 @@ public:
 	{
 		header.arrays = array_types;
 		if ( header.arrays & CY_HAIR_FILE_SEGMENTS_BIT && !segments ) segments = new unsigned short[header.hair_count];
-		if ( ! (header.arrays & CY_HAIR_FILE_SEGMENTS_BIT) && segments ) { delete [] segments; segments=NULL; }
+		if ( ! (header.arrays & CY_HAIR_FILE_SEGMENTS_BIT) && segments ) DeleteArray( segments );
 		if ( header.arrays & CY_HAIR_FILE_POINTS_BIT && !points ) points = new float[header.point_count*3];
-		if ( ! (header.arrays & CY_HAIR_FILE_POINTS_BIT) && points ) { delete [] points; points=NULL; }
+		if ( ! (header.arrays & CY_HAIR_FILE_POINTS_BIT) && points ) DeleteArray( points );
 		if ( header.arrays & CY_HAIR_FILE_THICKNESS_BIT && !thickness ) thickness = new float[header.point_count];
-		if ( ! (header.arrays & CY_HAIR_FILE_THICKNESS_BIT) && thickness ) { delete [] thickness; thickness=NULL; }
+		if ( ! (header.arrays & CY_HAIR_FILE_THICKNESS_BIT) && thickness ) DeleteArray( thickness );
 		if ( header.arrays & CY_HAIR_FILE_TRANSPARENCY_BIT && !transparency ) transparency = new float[header.point_count];
-		if ( ! (header.arrays & CY_HAIR_FILE_TRANSPARENCY_BIT) && transparency ) { delete [] transparency; transparency=NULL; }
+		if ( ! (header.arrays & CY_HAIR_FILE_TRANSPARENCY_BIT) && transparency ) DeleteArray( transparency );
 		if ( header.arrays & CY_HAIR_FILE_COLORS_BIT && !colors ) colors = new float[header.point_count*3];
-		if ( ! (header.arrays & CY_HAIR_FILE_COLORS_BIT) && colors ) { delete [] colors; colors=NULL; }
+		if ( ! (header.arrays & CY_HAIR_FILE_COLORS_BIT) && colors ) DeleteArray( colors );
 	}
 
 	//! Sets default number of segments for all hair strands, which is used if segments array does not exist.
@@ -202,8 +213,15 @@ public:
 	//!@name Load and Save Methods
 
 	//! Loads hair data from the given HAIR file.
-	int LoadFromFile( const char *filename )
+	//! If useMemoryMapping is true, the file is mapped into memory as read-only and the arrays point
+	//! directly into the mapping, so the arrays are not copied and their pages are read when they are
+	//! first accessed. The float arrays that are not aligned in the file (which happens when the file
+	//! has a segments array with an odd number of strands) are copied. The file must not be modified
+	//! while it is mapped. Use the constant data access methods to read the arrays without copying them.
+	int LoadFromFile( const char *filename, bool useMemoryMapping=false )
 	{
+		if ( useMemoryMapping ) return MapFile( filename );
+
 		Initialize();
 
 		FILE *fp;
@@ -288,71 +306,134 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	//!@name Other Methods
 
+	//! Computes the index of the first point of each hair strand, using a parallel prefix sum of the
+	//! segment counts. A strand with s segments has s+1 points. The offsets array must have hair count
+	//! plus one elements and the last element is set to the total number of points of all strands,
+	//! so the points of strand i are between offsets[i] and offsets[i+1]. Returns the total number of
+	//! points, which is only valid if it does not exceed the point count.
+	uint64_t ComputeStrandOffsets( unsigned int *offsets ) const
+	{
+		unsigned int hairCount = header.hair_count;
+		if ( ! segments ) {
+			for ( unsigned int i=0; i<=hairCount; i++ ) offsets[i] = i * ( header.d_segments + 1 );
+			return uint64_t(hairCount) * ( uint64_t(header.d_segments) + 1 );
+		}
+		// The segment counts of each range of strands are added in parallel, and then each range
+		// is scanned in parallel, starting with the sum of the previous ranges.
+		int rangeCount = ParallelRangeCount( hairCount );
+		std::vector<uint64_t> rangeStart( size_t(rangeCount) + 1, 0 );
+		ParallelForRanges( 0u, hairCount, rangeCount, [&]( int r, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			uint64_t sum = 0;
+			for ( unsigned int i=rangeBegin; i<rangeEnd; i++ ) sum += segments[i];
+			rangeStart[r+1] = sum + ( rangeEnd - rangeBegin );
+		} );
+		for ( int r=0; r<rangeCount; r++ ) rangeStart[r+1] += rangeStart[r];
+		ParallelForRanges( 0u, hairCount, rangeCount, [&]( int r, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			unsigned int p = (unsigned int) rangeStart[r];
+			for ( unsigned int i=rangeBegin; i<rangeEnd; i++ ) {
+				offsets[i] = p;
+				p += segments[i] + 1;
+			}
+		} );
+		offsets[hairCount] = (unsigned int) rangeStart[rangeCount];
+		return rangeStart[rangeCount];
+	}
+
 	//! Fills the given direction array with normalized directions using the points array.
 	//! Call this function if you need strand directions for shading.
 	//! The given array dir should be allocated as an array of size 3 times point count.
+	//! The strands are processed in parallel using the strand offsets (see ComputeStrandOffsets).
+	//! Strands with no segments have a single point and their direction is zero.
 	//! Returns point count, returns zero if fails.
-	int FillDirectionArray( float *dir )
+	int FillDirectionArray( float *dir ) const
 	{
 		if ( dir==NULL || header.point_count<=0 || points==NULL ) return 0;
+		std::vector<unsigned int> offsets( size_t(header.hair_count) + 1 );
+		if ( ComputeStrandOffsets( offsets.data() ) > header.point_count ) return 0;
+		return FillDirectionArray( dir, offsets.data() );
+	}
 
-		int p = 0;	// point index
-		for ( unsigned int i=0; i<header.hair_count; i++ ) {
-			int s = (segments) ? segments[i] : header.d_segments;
-			if ( s > 1 ) {
-				// direction at point1
-				float len0, len1;
-				ComputeDirection( &dir[(p+1)*3], len0, len1, &points[p*3], &points[(p+1)*3], &points[(p+2)*3] );
-
-				// direction at point0
-				float d0[3];
-				d0[0] = points[(p+1)*3]   - dir[(p+1)*3]  *len0*0.3333f - points[p*3];
-				d0[1] = points[(p+1)*3+1] - dir[(p+1)*3+1]*len0*0.3333f - points[p*3+1];
-				d0[2] = points[(p+1)*3+2] - dir[(p+1)*3+2]*len0*0.3333f - points[p*3+2];
-				float d0lensq = d0[0]*d0[0] + d0[1]*d0[1] + d0[2]*d0[2];
-				float d0len = ( d0lensq > 0 ) ? (float) sqrt(d0lensq) : 1.0f;
-				dir[p*3]   = d0[0] / d0len;
-				dir[p*3+1] = d0[1] / d0len;
-				dir[p*3+2] = d0[2] / d0len;
-
-				// We computed the first 2 points
-				p += 2;
-
-				// Compute the direction for the rest
-				for ( int t=2; t<s; t++, p++ ) {
-					ComputeDirection( &dir[p*3], len0, len1, &points[(p-1)*3], &points[p*3], &points[(p+1)*3] );
+	//! Fills the given direction array with normalized directions using the points array and the
+	//! given strand offsets, which must be computed using ComputeStrandOffsets.
+	//! Returns point count, returns zero if fails.
+	int FillDirectionArray( float *dir, const unsigned int *strandOffsets ) const
+	{
+		if ( dir==NULL || header.point_count<=0 || points==NULL ) return 0;
+		unsigned int hairCount = header.hair_count;
+		if ( strandOffsets[hairCount] > header.point_count ) return 0;
+
+		ParallelForRanges( 0u, hairCount, ParallelRangeCount(hairCount), [&]( int, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			// The directions at all points of the strands, except for the first and the last points
+			// of the range, are computed as the directions at the middle points of strands. The points
+			// are processed in blocks, which are copied into separate arrays of x, y, and z, so the loop
+			// is vectorized. Then, the directions at the end points of the strands are overwritten.
+			const unsigned int BLOCK = 16;
+			float x[BLOCK+2] = {}, y[BLOCK+2] = {}, z[BLOCK+2] = {};
+			float dx[BLOCK], dy[BLOCK], dz[BLOCK];
+			unsigned int pointBegin = strandOffsets[rangeBegin];
+			unsigned int pointEnd   = strandOffsets[rangeEnd];
+			for ( unsigned int b=pointBegin+1; b+1<pointEnd; b+=BLOCK ) {
+				unsigned int n = pointEnd-1-b < BLOCK ? pointEnd-1-b : BLOCK;
+				for ( unsigned int j=0; j<n+2; j++ ) {
+					const float *pt = &points[ size_t(b-1+j)*3 ];
+					x[j] = pt[0];
+					y[j] = pt[1];
+					z[j] = pt[2];
+				}
+				_CY_IVDEP_FOR ( unsigned int j=0; j<BLOCK; j++ ) {
+					// lines from the previous point to this point (d0) and from this point to the next point (d1)
+					float d0x = x[j+1]-x[j], d0y = y[j+1]-y[j], d0z = z[j+1]-z[j];
+					float d1x = x[j+2]-x[j+1], d1y = y[j+2]-y[j+1], d1z = z[j+2]-z[j+1];
+					float d0lensq = d0x*d0x + d0y*d0y + d0z*d0z;
+					float d1lensq = d1x*d1x + d1y*d1y + d1z*d1z;
+					float d0len = ( d0lensq > 0 ) ? cySqrt(d0lensq) : 1.0f;
+					float d1len = ( d1lensq > 0 ) ? cySqrt(d1lensq) : 1.0f;
+					// make sure that d0 and d1 has the same length
+					float ux = d0x * (d1len / d0len) + d1x;
+					float uy = d0y * (d1len / d0len) + d1y;
+					float uz = d0z * (d1len / d0len) + d1z;
+					float ulensq = ux*ux + uy*uy + uz*uz;
+					float ulen = ( ulensq > 0 ) ? cySqrt(ulensq) : 1.0f;
+					dx[j] = ux / ulen;
+					dy[j] = uy / ulen;
+					dz[j] = uz / ulen;
+				}
+				for ( unsigned int j=0; j<n; j++ ) {
+					float *d = &dir[ size_t(b+j)*3 ];
+					d[0] = dx[j];
+					d[1] = dy[j];
+					d[2] = dz[j];
 				}
-
-				// direction at the last point
-				d0[0] = - points[(p-1)*3]   + dir[(p-1)*3]  *len1*0.3333f + points[p*3];
-				d0[1] = - points[(p-1)*3+1] + dir[(p-1)*3+1]*len1*0.3333f + points[p*3+1];
-				d0[2] = - points[(p-1)*3+2] + dir[(p-1)*3+2]*len1*0.3333f + points[p*3+2];
-				d0lensq = d0[0]*d0[0] + d0[1]*d0[1] + d0[2]*d0[2];
-				d0len = ( d0lensq > 0 ) ? (float) sqrt(d0lensq) : 1.0f;
-				dir[p*3]   = d0[0] / d0len;
-				dir[p*3+1] = d0[1] / d0len;
-				dir[p*3+2] = d0[2] / d0len;
-				p++;
-
-			} else if ( s > 0 ) {
-				// if it has a single segment
-				float d0[3];
-				d0[0] = points[(p+1)*3]   - points[p*3];
-				d0[1] = points[(p+1)*3+1] - points[p*3+1];
-				d0[2] = points[(p+1)*3+2] - points[p*3+2];
-				float d0lensq = d0[0]*d0[0] + d0[1]*d0[1] + d0[2]*d0[2];
-				float d0len = ( d0lensq > 0 ) ? (float) sqrt(d0lensq) : 1.0f;
-				dir[p*3]   = d0[0] / d0len;
-				dir[p*3+1] = d0[1] / d0len;
-				dir[p*3+2] = d0[2] / d0len;
-				dir[(p+1)*3]   = dir[p*3];
-				dir[(p+1)*3+1] = dir[p*3+1];
-				dir[(p+1)*3+2] = dir[p*3+2];
-				p += 2;
 			}
-			//*/
-		}
-		return p;
+			for ( unsigned int i=rangeBegin; i<rangeEnd; i++ ) {
+				unsigned int p = strandOffsets[i];
+				unsigned int s = strandOffsets[i+1] - p - 1;
+				if ( s > 1 ) {
+					// direction at point0
+					float len0 = Distance( &points[p*3], &points[(p+1)*3] );
+					SetDirection( &dir[p*3], points[(p+1)*3]   - dir[(p+1)*3]  *len0*0.3333f - points[p*3],
+					                         points[(p+1)*3+1] - dir[(p+1)*3+1]*len0*0.3333f - points[p*3+1],
+					                         points[(p+1)*3+2] - dir[(p+1)*3+2]*len0*0.3333f - points[p*3+2] );
+					// direction at the last point
+					p += s;
+					float len1 = Distance( &points[(p-1)*3], &points[p*3] );
+					SetDirection( &dir[p*3], - points[(p-1)*3]   + dir[(p-1)*3]  *len1*0.3333f + points[p*3],
+					                         - points[(p-1)*3+1] + dir[(p-1)*3+1]*len1*0.3333f + points[p*3+1],
+					                         - points[(p-1)*3+2] + dir[(p-1)*3+2]*len1*0.3333f + points[p*3+2] );
+				} else if ( s > 0 ) {
+					// if it has a single segment
+					SetDirection( &dir[p*3], points[(p+1)*3]   - points[p*3],
+					                         points[(p+1)*3+1] - points[p*3+1],
+					                         points[(p+1)*3+2] - points[p*3+2] );
+					dir[(p+1)*3]   = dir[p*3];
+					dir[(p+1)*3+1] = dir[p*3+1];
+					dir[(p+1)*3+2] = dir[p*3+2];
+				} else {
+					dir[p*3] = dir[p*3+1] = dir[p*3+2] = 0;
+				}
+			}
+		} );
+		return (int) strandOffsets[hairCount];
 	}
 
 
@@ -366,42 +447,86 @@ private:
 	float			*thickness;
 	float			*transparency;
 	float			*colors;
+	MappedFile		mappedFile;		// The HAIR file that the arrays may point into
+
+	// Deletes the array, unless it points into the mapped file.
+	template <typename T> void DeleteArray( T* &array ) { if ( array && !mappedFile.Contains(array) ) delete [] array; array = NULL; }
 
-	// Given point before (p0) and after (p2), computes the direction (d) at p1.
-	float ComputeDirection( float *d, float &d0len, float &d1len, const float *p0, const float *p1, const float *p2 )
+	// Replaces the array with a copy, if it points into the mapped file.
+	template <typename T> T* Detach( T* &array, size_t count )
 	{
-		// line from p0 to p1
-		float d0[3];
-		d0[0] = p1[0] - p0[0];
-		d0[1] = p1[1] - p0[1];
-		d0[2] = p1[2] - p0[2];
-		float d0lensq = d0[0]*d0[0] + d0[1]*d0[1] + d0[2]*d0[2];
-		d0len = ( d0lensq > 0 ) ? (float) sqrt(d0lensq) : 1.0f;
-
-		// line from p1 to p2
-		float d1[3];
-		d1[0] = p2[0] - p1[0];
-		d1[1] = p2[1] - p1[1];
-		d1[2] = p2[2] - p1[2];
-		float d1lensq = d1[0]*d1[0] + d1[1]*d1[1] + d1[2]*d1[2];
-		d1len = ( d1lensq > 0 ) ? (float) sqrt(d1lensq) : 1.0f;
-
-		// make sure that d0 and d1 has the same length
-		d0[0] *= d1len / d0len;
-		d0[1] *= d1len / d0len;
-		d0[2] *= d1len / d0len;
-
-		// direction at p1
-		d[0] = d0[0] + d1[0];
-		d[1] = d0[1] + d1[1];
-		d[2] = d0[2] + d1[2];
+		if ( array && mappedFile.Contains(array) ) {
+			T *copy = new T[count];
+			memcpy( copy, array, count*sizeof(T) );
+			array = copy;
+		}
+		return array;
+	}
+
+	// Sets the array to point to the given number of elements at the given offset of the mapped file and advances
+	// the offset. If the elements are not aligned in the file, they are copied. Returns false if the file is too short.
+	template <typename T> bool MapArray( T* &array, size_t count, size_t &offset )
+	{
+		if ( count > ( mappedFile.Size() - offset ) / sizeof(T) ) return false;
+		char *p = mappedFile.Data() + offset;
+		if ( size_t(p) % alignof(T) == 0 ) array = (T*) p;
+		else {
+			array = new T[count];
+			memcpy( array, p, count*sizeof(T) );
+		}
+		offset += count*sizeof(T);
+		return true;
+	}
+
+	// Loads the HAIR file using memory mapping.
+	int MapFile( const char *filename )
+	{
+		Initialize();
+		if ( ! mappedFile.Open( filename, true ) ) {
+			int64_t time;
+			uint64_t size;
+			bool isEmpty = MappedFile::GetFileInfo( filename, time, size ) && size == 0;	// empty files cannot be mapped
+			return isEmpty ? CY_HAIR_FILE_ERROR_CANT_READ_HEADER : CY_HAIR_FILE_ERROR_CANT_OPEN_FILE;
+		}
+		if ( mappedFile.Size() < sizeof(Header) ) { Initialize(); return CY_HAIR_FILE_ERROR_CANT_READ_HEADER; }
+		memcpy( &header, mappedFile.Data(), sizeof(Header) );
+		if ( strncmp( header.signature, "HAIR", 4 ) != 0 ) { Initialize(); return CY_HAIR_FILE_ERROR_WRONG_SIGNATURE; }
+
+		size_t offset = sizeof(Header);
+		size_t pointCount = header.point_count;
+		int error = 0;
+		if      ( (header.arrays & CY_HAIR_FILE_SEGMENTS_BIT)     && ! MapArray( segments,     header.hair_count, offset ) ) error = CY_HAIR_FILE_ERROR_READING_SEGMENTS;
+		else if ( (header.arrays & CY_HAIR_FILE_POINTS_BIT)       && ! MapArray( points,       pointCount*3,      offset ) ) error = CY_HAIR_FILE_ERROR_READING_POINTS;
+		else if ( (header.arrays & CY_HAIR_FILE_THICKNESS_BIT)    && ! MapArray( thickness,    pointCount,        offset ) ) error = CY_HAIR_FILE_ERROR_READING_THICKNESS;
+		else if ( (header.arrays & CY_HAIR_FILE_TRANSPARENCY_BIT) && ! MapArray( transparency, pointCount,        offset ) ) error = CY_HAIR_FILE_ERROR_READING_TRANSPARENCY;
+		else if ( (header.arrays & CY_HAIR_FILE_COLORS_BIT)       && ! MapArray( colors,       pointCount*3,      offset ) ) error = CY_HAIR_FILE_ERROR_READING_COLORS;
+		if ( error ) { Initialize(); return error; }
+
+		// Close the mapping, if none of the arrays point into it
+		if ( ! mappedFile.Contains(segments) && ! mappedFile.Contains(points) && ! mappedFile.Contains(thickness) && ! mappedFile.Contains(transparency) && ! mappedFile.Contains(colors) ) mappedFile.Close();
+
+		return header.hair_count;
+	}
+
+	// Returns the distance between the given points, or one if the points are the same.
+	static float Distance( const float *p0, const float *p1 )
+	{
+		float d[3];
+		d[0] = p1[0] - p0[0];
+		d[1] = p1[1] - p0[1];
+		d[2] = p1[2] - p0[2];
 		float dlensq = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
-		float dlen = ( dlensq > 0 ) ? (float) sqrt(dlensq) : 1.0f;
-		d[0] /= dlen;
-		d[1] /= dlen;
-		d[2] /= dlen;
+		return ( dlensq > 0 ) ? (float) sqrt(dlensq) : 1.0f;
+	}
 
-		return d0len;
+	// Sets the direction (d) as the given vector normalized.
+	static void SetDirection( float *d, float x, float y, float z )
+	{
+		float dlensq = x*x + y*y + z*z;
+		float dlen = ( dlensq > 0 ) ? (float) sqrt(dlensq) : 1.0f;
+		d[0] = x / dlen;
+		d[1] = y / dlen;
+		d[2] = z / dlen;
 	}
 };
 
@@ -6,7 +6,9 @@
 //!
 //! \brief  A general-purpose heap class
 //! 
-//! This file includes a general-purpose heap class.
+//! This file includes a general-purpose heap class and a d-ary variant
+//! that keeps copies of the items next to their ids for fewer cache misses.
+//! Both are max-heaps by default and min-heaps with the std::greater comparator.
 //!
 //-------------------------------------------------------------------------------
 //
@@ -40,6 +42,9 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 //-------------------------------------------------------------------------------
 namespace cy {
@@ -48,15 +53,23 @@ namespace cy {
 //! A general-purpose max-heap structure that allows random access and updates.
 //!
 //! The main data can be kept in an external array or within the Heap class.
-
-template <typename DATA_TYPE, typename SIZE_TYPE=size_t> 
+//!
+//! The order of the items is determined by the COMPARE function object, which returns true
+//! if its first argument has lower priority than the second one. The default std::less comparator
+//! makes a max-heap and std::greater makes a min-heap (see MinHeap), so the keys do not need
+//! to be negated or wrapped. The main data can simply be the array of keys, such as float or double
+//! values, indexed by the item ids, and any other data of the items can be kept in separate arrays
+//! with the same ids. This way the keys stay contiguous, and they can be shared with the
+//! other structures using SetDataPointer.
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t, typename COMPARE=std::less<DATA_TYPE>> 
 class Heap
 {
 public:
 	//////////////////////////////////////////////////////////////////////////!//!//!
 	//!@name Constructor and Destructor
 
-	Heap() : size(0), heapItemCount(0), data(nullptr), heap(nullptr), heapPos(nullptr), deleteData(false) {}
+	Heap( const COMPARE &comp=COMPARE() ) : size(0), heapItemCount(0), heapCapacity(0), data(nullptr), heap(nullptr), heapPos(nullptr), deleteData(false), markedUp(false), compare(comp) {}
 	~Heap() { Clear(); }
 
 	//////////////////////////////////////////////////////////////////////////!//!//!
@@ -105,17 +118,22 @@ public:
 
 	//! The Build method builds the heap structure using the main data. Therefore,
 	//! the main data must be set using either CopyData, MoveData, or SetDataPointer
-	//! before calling the Build method.
+	//! before calling the Build method. The memory used by a previously built heap
+	//! structure is reused, if it is large enough.
 	void Build()
 	{
-		ClearHeap();
+		if ( heapCapacity < size ) {
+			ClearHeap();
+			heap    = new SIZE_TYPE[ size + 1 ];
+			heapPos = new SIZE_TYPE[ size ];
+			heapCapacity = size;
+		}
 		heapItemCount = size;
-		heap    = new SIZE_TYPE[ size + 1 ];
-		heapPos = new SIZE_TYPE[ size ];
 		for ( SIZE_TYPE i=0; i< heapItemCount; i++ ) heapPos[i] = i+1;
 		for ( SIZE_TYPE i=1; i<=heapItemCount; i++ ) heap   [i] = i-1;
-		if ( heapItemCount <= 1 ) return;
-		for ( SIZE_TYPE ix = heapItemCount/2; ix>0; ix-- ) HeapMoveDown(ix);
+		markedItems.clear();
+		markedUp = false;
+		Heapify();
 	}
 
 	//////////////////////////////////////////////////////////////////////////!//!//!
@@ -171,7 +189,7 @@ public:
 	void Pop( DATA_TYPE &item )
 	{
 		Pop();
-		item = data[ heap[heapItemCount] ];
+		item = data[ heap[heapItemCount+1] ];
 	}
 
 	//! Removes the item at the top of the heap.
@@ -184,6 +202,104 @@ public:
 		HeapMoveDown(1);
 	}
 
+	//! Removes the given number of items from the top of the heap.
+	//! The removed items are placed after the last item in the heap, as if Pop was called count times,
+	//! though items with equal values can be removed in a different order.
+	//! The removed items are found by searching the top of the heap, and the positions they leave
+	//! are filled with the last items in the heap and fixed using a single bottom-up pass.
+	//! When a large portion of the heap is removed, the items are simply popped one by one.
+	void PopMultiple( SIZE_TYPE count )
+	{
+		if ( count > heapItemCount ) count = heapItemCount;
+		if ( count == 0 ) return;
+		if ( count * HeapDepth() >= heapItemCount ) {
+			for ( SIZE_TYPE i=0; i<count; i++ ) Pop();
+			return;
+		}
+
+		// Find the heap positions of the top items in order, using a heap of candidate positions
+		std::vector<SIZE_TYPE> topPos, candidates;
+		topPos.reserve( count );
+		candidates.push_back( 1 );
+		auto IsSmallerPos = [this]( SIZE_TYPE ix1, SIZE_TYPE ix2 ) { return IsSmaller(ix1,ix2); };
+		while ( topPos.size() < count ) {
+			std::pop_heap( candidates.begin(), candidates.end(), IsSmallerPos );
+			SIZE_TYPE ix = candidates.back();
+			candidates.pop_back();
+			topPos.push_back( ix );
+			for ( SIZE_TYPE c=ix*2; c<=ix*2+1 && c<=heapItemCount; c++ ) {
+				candidates.push_back( c );
+				std::push_heap( candidates.begin(), candidates.end(), IsSmallerPos );
+			}
+		}
+
+		// Fill the vacated positions in the remaining heap with the items that are not removed from its end.
+		// The removed items are marked with heap position zero.
+		SIZE_TYPE newCount = heapItemCount - count;
+		std::vector<SIZE_TYPE> ids( count ), holes;
+		for ( SIZE_TYPE j=0; j<count; j++ ) {
+			ids[j] = heap[ topPos[j] ];
+			heapPos[ ids[j] ] = 0;
+			if ( topPos[j] <= newCount ) holes.push_back( topPos[j] );
+		}
+		SIZE_TYPE h = 0;
+		for ( SIZE_TYPE ix=newCount+1; ix<=heapItemCount; ix++ ) {
+			SIZE_TYPE id = heap[ix];
+			if ( heapPos[id] == 0 ) continue;
+			heap[ holes[h] ] = id;
+			heapPos[id] = holes[h++];
+		}
+		for ( SIZE_TYPE j=0; j<count; j++ ) {
+			heap[ heapItemCount-j ] = ids[j];
+			heapPos[ ids[j] ] = heapItemCount-j;
+		}
+		heapItemCount = newCount;
+
+		// The vacated positions include all of their ancestors, so they can be fixed bottom-up
+		FixPositions( holes );
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Batch update methods
+
+	//! Marks the item with the given id as modified externally, without updating the heap structure.
+	//! All marked items are updated together by UpdateMarkedItems, which must be called
+	//! before using any other method that accesses the heap structure.
+	//! Items can be marked multiple times and items removed from the heap (by Pop) are ignored.
+	void MarkItem( SIZE_TYPE id ) { assert(id<size); markedItems.push_back(id); markedUp = true; }
+
+	//! Marks the item with the given id as modified externally to decrease its priority,
+	//! without updating the heap structure. It is the batch version of MoveItemDown.
+	//! Since decreasing the priority of an item cannot affect its ancestors in the heap,
+	//! updating items marked this way is cheaper than the ones marked by MarkItem.
+	void MarkItemDown( SIZE_TYPE id ) { assert(id<size); markedItems.push_back(id); }
+
+	//! Returns the number of times items are marked since the last update.
+	SIZE_TYPE NumMarkedItems() const { return (SIZE_TYPE) markedItems.size(); }
+
+	//! Updates the heap structure for all items marked by MarkItem or MarkItemDown.
+	//! The marked heap positions are sorted and moved down starting from the bottom of the heap,
+	//! including their ancestors if any item is marked by MarkItem. If this would touch too many items,
+	//! the whole heap is rebuilt bottom-up instead, which is cheaper than moving each item.
+	void UpdateMarkedItems()
+	{
+		SIZE_TYPE n = 0;
+		for ( SIZE_TYPE id : markedItems ) {
+			SIZE_TYPE ix = heapPos[id];
+			if ( ix <= heapItemCount ) markedItems[n++] = ix;
+		}
+		markedItems.resize( n );
+		if ( markedUp ) {
+			// An item with increased priority can move above its ancestors
+			for ( SIZE_TYPE i=0; i<n && markedItems.size()<heapItemCount; i++ ) {
+				for ( SIZE_TYPE ix=markedItems[i]/2; ix>0; ix/=2 ) markedItems.push_back(ix);
+			}
+		}
+		FixPositions( markedItems );
+		markedItems.clear();
+		markedUp = false;
+	}
+
 private:
 	//////////////////////////////////////////////////////////////////////////!//!//!
 	//!@name Internal structures and methods
@@ -192,8 +308,12 @@ private:
 	SIZE_TYPE *heap;			// The heap array, keeping the id of each data item.
 	SIZE_TYPE *heapPos;			// The heap position of each item.
 	SIZE_TYPE heapItemCount;	// The number of items in the heap.
+	SIZE_TYPE heapCapacity;		// The number of items that the heap arrays can hold.
 	SIZE_TYPE size;				// The total item count, including the ones removed from the heap.
 	bool deleteData;			// Determines whether the data pointer owns the memory it points to.
+	std::vector<SIZE_TYPE> markedItems;	// The ids of the items marked for a batch update.
+	bool markedUp;				// Determines whether any marked item can have increased priority.
+	COMPARE compare;			// The comparison function object.
 
 	// Clears the data pointer and deallocates memory if the data is owned.
 	void ClearData()
@@ -210,6 +330,39 @@ private:
 		delete [] heap;    heap    = nullptr;
 		delete [] heapPos; heapPos = nullptr;
 		heapItemCount = 0;
+		heapCapacity = 0;
+		markedItems.clear();
+		markedUp = false;
+	}
+
+	// Builds the heap structure bottom-up from the items in the heap.
+	void Heapify()
+	{
+		if ( heapItemCount <= 1 ) return;
+		for ( SIZE_TYPE ix = heapItemCount/2; ix>0; ix-- ) HeapMoveDown(ix);
+	}
+
+	// Returns the number of levels of the heap.
+	SIZE_TYPE HeapDepth() const
+	{
+		SIZE_TYPE depth = 1;
+		for ( SIZE_TYPE c=heapItemCount; c>1; c>>=1 ) depth++;
+		return depth;
+	}
+
+	// Fixes the heap structure by moving down the items at the given heap positions, starting from the bottom.
+	// The ancestors of a position must be in the list, unless the item at that position has decreased priority.
+	// If there are more positions than one eighth of the heap, rebuilding the heap is cheaper.
+	void FixPositions( std::vector<SIZE_TYPE> &positions )
+	{
+		if ( positions.empty() ) return;
+		if ( SIZE_TYPE(positions.size()) * 8 >= heapItemCount ) {
+			Heapify();
+			return;
+		}
+		std::sort( positions.begin(), positions.end(), []( SIZE_TYPE a, SIZE_TYPE b ) { return a > b; } );
+		auto last = std::unique( positions.begin(), positions.end() );
+		for ( auto p=positions.begin(); p!=last; ++p ) HeapMoveDown( *p );
 	}
 
 	// Checks if the item should be moved.
@@ -257,7 +410,7 @@ private:
 	}
 
 	// Returns if the item at ix1 is smaller than the one at ix2.
-	bool IsSmaller( SIZE_TYPE ix1, SIZE_TYPE ix2 ) { return data[heap[ix1]] < data[heap[ix2]]; }
+	bool IsSmaller( SIZE_TYPE ix1, SIZE_TYPE ix2 ) { return compare( data[heap[ix1]], data[heap[ix2]] ); }
 
 	// Swaps the heap positions of items at ix1 and ix2.
 	void SwapItems( SIZE_TYPE ix1, SIZE_TYPE ix2 )
@@ -272,6 +425,279 @@ private:
 	//////////////////////////////////////////////////////////////////////////!//!//!
 };
 
+//-------------------------------------------------------------------------------
+
+//! A d-ary max-heap structure that allows random access and updates.
+//!
+//! It has the same interface as the Heap class, but each node of the heap keeps a copy of the
+//! data item along with its id, so comparisons do not access the main data array. The children of
+//! a node are stored next to each other and they are aligned to cache lines when the size of
+//! ARITY nodes is a multiple of the cache line size, such as 4 nodes of a double and a 32-bit id
+//! padded to 16 bytes, or 8 nodes of a float and a 32-bit id. A heap with a higher arity is shallower,
+//! so moving items down needs fewer levels but more comparisons per level. Each comparison of
+//! the children of a node accesses a single cache line, instead of an item of the main data array.
+//!
+//! Since the heap nodes keep copies of the data items, an item that is modified externally must be
+//! updated using one of the MoveItem methods before any other heap operation, as with the Heap class.
+//! The main data can be kept in an external array or within the class.
+//! The COMPARE function object determines the order of the items, as with the Heap class.
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t, int ARITY=4, typename COMPARE=std::less<DATA_TYPE>>
+class DAryHeap
+{
+	static_assert( ARITY >= 2, "The arity of the heap must be at least 2." );
+public:
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Constructor and Destructor
+
+	DAryHeap( const COMPARE &comp=COMPARE() ) : data(nullptr), heap(nullptr), heapPos(nullptr), nodeBuffer(nullptr), heapItemCount(0), heapCapacity(0), size(0), deleteData(false), compare(comp) {}
+	~DAryHeap() { Clear(); }
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Initialization methods
+
+	//! Deletes all data owned by the class.
+	void Clear() { ClearData(); ClearHeap(); }
+
+	//! Copies the main data items from an array into the internal storage of this class.
+	void CopyData( const DATA_TYPE *items, SIZE_TYPE itemCount )
+	{
+		ClearData();
+		size = itemCount;
+		data = new DATA_TYPE[size];
+		for ( SIZE_TYPE i=0; i<size; i++ ) data[i] = items[i];
+		deleteData = true;
+	}
+
+	//! Moves the main data items from an array to the internal storage of this class.
+	//! The given array must NOT be deleted externally. When the class object is deleted,
+	//! the data items are deleted as well. If this is not desirable, use SetDataPointer.
+	void MoveData( DATA_TYPE *items, SIZE_TYPE itemCount )
+	{
+		ClearData();
+		data = items;
+		size = itemCount;
+		deleteData = true;
+	}
+
+	//! Sets the data pointer of this class without claiming the ownership of the data.
+	//! The data items must NOT be deleted while an object of this class is used.
+	void SetDataPointer( DATA_TYPE *items, SIZE_TYPE itemCount )
+	{
+		ClearData();
+		data = items;
+		size = itemCount;
+		deleteData = false;
+	}
+
+	//! The Build method builds the heap structure using the main data. Therefore,
+	//! the main data must be set using either CopyData, MoveData, or SetDataPointer
+	//! before calling the Build method. The memory used by a previously built heap
+	//! structure is reused, if it is large enough.
+	void Build()
+	{
+		if ( heapCapacity < size ) {
+			ClearHeap();
+			// Align the first child group (the node at index 1) to a cache line, if possible
+			const size_t lineNodes = sizeof(Node) < 64 ? 64 / sizeof(Node) : 1;
+			nodeBuffer = new Node[ size + lineNodes ];
+			size_t offset = 0;
+			if ( 64 % sizeof(Node) == 0 ) {
+				while ( offset < lineNodes && ( (uintptr_t)(nodeBuffer + offset + 1) & 63 ) != 0 ) offset++;
+				if ( offset == lineNodes ) offset = 0;
+			}
+			heap    = nodeBuffer + offset;
+			heapPos = new SIZE_TYPE[ size ];
+			heapCapacity = size;
+		}
+		heapItemCount = size;
+		for ( SIZE_TYPE i=0; i<heapItemCount; i++ ) {
+			heap[i].item = data[i];
+			heap[i].id   = i;
+			heapPos[i]   = i;
+		}
+		if ( heapItemCount <= 1 ) return;
+		for ( SIZE_TYPE ix = (heapItemCount-2)/ARITY + 1; ix>0; ix-- ) HeapMoveDown(ix-1);
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Access and manipulation methods
+
+	//! Returns the item from the main data with the given id.
+	const DATA_TYPE& GetItem( SIZE_TYPE id ) const { assert(id<size); return data[id]; }
+
+	//! Sets the item with the given id and updates the heap structure accordingly.
+	//! Returns false if the item is not in the heap anymore (removed by Pop) or if its heap position is not changed.
+	bool SetItem( SIZE_TYPE id, const DATA_TYPE &item ) { assert(id<size); data[id]=item; return MoveItem(id); }
+
+	//! Moves the item with the given id to the correct position in the heap.
+	//! This method is useful for fixing the heap position after an item is modified externally.
+	//! Returns false if the item is not in the heap anymore (removed by Pop) or if its heap position is not changed.
+	bool MoveItem( SIZE_TYPE id )
+	{
+		SIZE_TYPE ix = heapPos[id];
+		if ( ix >= heapItemCount ) return false;
+		heap[ix].item = data[id];
+		if ( HeapMoveUp(ix) ) return true;
+		return HeapMoveDown(ix);
+	}
+
+	//! Moves the item with the given id towards the top of the heap.
+	//! This method is useful for fixing the heap position after an item is modified externally to increase its priority.
+	//! Returns false if the item is not in the heap anymore (removed by Pop) or if its heap position is not changed.
+	bool MoveItemUp( SIZE_TYPE id ) { return UpdateItem(id) && HeapMoveUp(heapPos[id]); }
+
+	//! Moves the item with the given id towards the bottom of the heap.
+	//! This method is useful for fixing the heap position after an item is modified externally to decrease its priority.
+	//! Returns false if the item is not in the heap anymore (removed by Pop) or if its heap position is not changed.
+	bool MoveItemDown( SIZE_TYPE id ) { return UpdateItem(id) && HeapMoveDown(heapPos[id]); }
+
+	//! Returns if the item with the given id is in the heap or removed by Pop.
+	bool IsInHeap( SIZE_TYPE id ) const { assert(id<size); return heapPos[id]<heapItemCount; }
+
+	//! Returns the number of items in the heap.
+	SIZE_TYPE NumItemsInHeap() const { return heapItemCount; }
+
+	//! Returns the item from the heap with the given heap position.
+	//! Note that items that are removed from the heap appear in the inverse order
+	//! with which they were removed after the last item in the heap.
+	const DATA_TYPE& GetFromHeap( SIZE_TYPE heapIndex ) const { assert(heapIndex<size); return data[heap[heapIndex].id]; }
+
+	//! Returns the id of the item from the heap with the given heap position.
+	//! Note that items that are removed from the heap appear in the inverse order
+	//! with which they were removed after the last item in the heap.
+	SIZE_TYPE GetIDFromHeap( SIZE_TYPE heapIndex ) const { assert(heapIndex<size); return heap[heapIndex].id; }
+
+	//! Returns the item at the top of the heap.
+	const DATA_TYPE& GetTopItem() const { assert(size>=1); return data[heap[0].id]; }
+
+	//! Returns the id of the item at the top of the heap.
+	SIZE_TYPE GetTopItemID() const { assert(size>=1); return heap[0].id; }
+
+	//! Removes and returns the item at the top of the heap.
+	//! The removed item is not deleted, but it is removed from the heap
+	//! by placing it right after the last item in the heap.
+	void Pop( DATA_TYPE &item )
+	{
+		Pop();
+		item = data[ heap[heapItemCount].id ];
+	}
+
+	//! Removes the item at the top of the heap.
+	//! The removed item is not deleted, but it is removed from the heap
+	//! by placing it right after the last item in the heap.
+	void Pop()
+	{
+		heapItemCount--;
+		Node top = heap[0];
+		heap[0] = heap[heapItemCount];
+		heapPos[ heap[0].id ] = 0;
+		heap[heapItemCount] = top;
+		heapPos[ top.id ] = heapItemCount;
+		HeapMoveDown(0);
+	}
+
+private:
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Internal structures and methods
+
+	struct Node {
+		DATA_TYPE item;		// A copy of the data item.
+		SIZE_TYPE id;		// The id of the data item.
+	};
+
+	DATA_TYPE *data;			// The main data pointer.
+	Node      *heap;			// The heap array, keeping a copy and the id of each data item.
+	SIZE_TYPE *heapPos;			// The heap position of each item.
+	Node      *nodeBuffer;		// The allocated memory for the heap array.
+	SIZE_TYPE heapItemCount;	// The number of items in the heap.
+	SIZE_TYPE heapCapacity;		// The number of items that the heap arrays can hold.
+	SIZE_TYPE size;				// The total item count, including the ones removed from the heap.
+	bool deleteData;			// Determines whether the data pointer owns the memory it points to.
+	COMPARE compare;			// The comparison function object.
+
+	// Clears the data pointer and deallocates memory if the data is owned.
+	void ClearData()
+	{
+		if ( deleteData ) delete [] data;
+		data = nullptr;
+		deleteData = false;
+		size = 0;
+	}
+
+	// Clears the heap structure.
+	void ClearHeap()
+	{
+		delete [] nodeBuffer; nodeBuffer = nullptr; heap = nullptr;
+		delete [] heapPos;    heapPos    = nullptr;
+		heapItemCount = 0;
+		heapCapacity = 0;
+	}
+
+	// Copies the data item to its heap node. Returns true if the item is in the heap.
+	bool UpdateItem( SIZE_TYPE id )
+	{
+		SIZE_TYPE ix = heapPos[id];
+		if ( ix >= heapItemCount ) return false;
+		heap[ix].item = data[id];
+		return true;
+	}
+
+	// Checks if the item should be moved up, returns true if the item is moved.
+	bool HeapMoveUp( SIZE_TYPE ix )
+	{
+		SIZE_TYPE org = ix;
+		Node node = heap[ix];
+		while ( ix > 0 ) {
+			SIZE_TYPE parent = (ix-1) / ARITY;
+			if ( ! compare( heap[parent].item, node.item ) ) break;
+			heap[ix] = heap[parent];
+			heapPos[ heap[ix].id ] = ix;
+			ix = parent;
+		}
+		if ( ix == org ) return false;
+		heap[ix] = node;
+		heapPos[ node.id ] = ix;
+		return true;
+	}
+
+	// Checks if the item should be moved down, returns true if the item is moved.
+	bool HeapMoveDown( SIZE_TYPE ix )
+	{
+		SIZE_TYPE org = ix;
+		Node node = heap[ix];
+		for (;;) {
+			SIZE_TYPE first = ix * ARITY + 1;
+			if ( first >= heapItemCount ) break;
+			SIZE_TYPE last = first + ARITY < heapItemCount ? first + ARITY : heapItemCount;
+			SIZE_TYPE child = first;
+			for ( SIZE_TYPE c=first+1; c<last; c++ ) if ( compare( heap[child].item, heap[c].item ) ) child = c;
+			if ( ! compare( node.item, heap[child].item ) ) break;
+			heap[ix] = heap[child];
+			heapPos[ heap[ix].id ] = ix;
+			ix = child;
+		}
+		if ( ix == org ) return false;
+		heap[ix] = node;
+		heapPos[ node.id ] = ix;
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+};
+
+//-------------------------------------------------------------------------------
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t> using MaxHeap = Heap<DATA_TYPE,SIZE_TYPE,std::less   <DATA_TYPE>>;	//!< Max-heap, the same as the default Heap
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t> using MinHeap = Heap<DATA_TYPE,SIZE_TYPE,std::greater<DATA_TYPE>>;	//!< Min-heap, with the smallest item at the top
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t, int ARITY=4> using DAryMinHeap = DAryHeap<DATA_TYPE,SIZE_TYPE,ARITY,std::greater<DATA_TYPE>>;	//!< D-ary min-heap, with the smallest item at the top
+
+typedef MinHeap<float>  MinHeapf;	//!< Min-heap of single precision (float) keys
+typedef MinHeap<double> MinHeapd;	//!< Min-heap of double precision (double) keys
+typedef MaxHeap<float>  MaxHeapf;	//!< Max-heap of single precision (float) keys
+typedef MaxHeap<double> MaxHeapd;	//!< Max-heap of double precision (double) keys
+
 //-------------------------------------------------------------------------------
 } // namespace cy
 //-------------------------------------------------------------------------------
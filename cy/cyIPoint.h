@@ -274,7 +274,7 @@ public:
 
 	//!@name Test operators
 	bool operator == ( const IPoint2& p ) const { return x==p.x && y==p.y; }
-	bool operator != ( const IPoint2& p ) const { return x!=p.x && y!=p.y; }
+	bool operator != ( const IPoint2& p ) const { return x!=p.x || y!=p.y; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
@@ -390,7 +390,7 @@ public:
 
 	//!@name Test operators
 	bool operator == ( const IPoint3& p ) const { return x==p.x && y==p.y && z==p.z; }
-	bool operator != ( const IPoint3& p ) const { return x!=p.x && y!=p.y && z!=p.z; }
+	bool operator != ( const IPoint3& p ) const { return x!=p.x || y!=p.y || z!=p.z; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
@@ -508,8 +508,8 @@ public:
 	const IPoint4& operator  ^= ( const TYPE    &v ) { x ^=v;   y ^=v;   z ^=v;   w ^=v;   return *this; }
 
 	//!@name Test operators
-	bool operator == ( const IPoint4& p ) const { return x==p.x && y==p.y && z==p.z; && w==p.w; }
-	bool operator != ( const IPoint4& p ) const { return x!=p.x && y!=p.y && z!=p.z; && w!=p.w; }
+	bool operator == ( const IPoint4& p ) const { return x==p.x && y==p.y && z==p.z && w==p.w; }
+	bool operator != ( const IPoint4& p ) const { return x!=p.x || y!=p.y || z!=p.z || w!=p.w; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
@@ -0,0 +1,179 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyMappedFile.h
+//! \author Cem Yuksel
+//!
+//! \brief  Memory-mapped file class.
+//!
+//! This file includes a class that maps a whole file into memory, so that
+//! binary data can be used directly from the file without reading it.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_MAPPED_FILE_H_INCLUDED_
+#define _CY_MAPPED_FILE_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Memory-mapped file class.
+//!
+//! Maps the whole file into memory with copy-on-write or read-only access. With copy-on-write
+//! access, the mapped data can be modified, but the modifications are never written back to the
+//! file. The pages of the file are loaded by the operating system when they are first accessed.
+
+class MappedFile
+{
+public:
+	//!@name Constructor and destructor
+	MappedFile() : data(NULL), size(0) {}
+	~MappedFile() { Close(); }
+
+	//!@name Mapping methods
+
+	//! Maps the given file into memory. Returns false if the file cannot be opened or mapped,
+	//! or if the file is empty. If readOnly is true, the mapped data must not be modified, but
+	//! the mapping does not reserve memory for copies of the pages, which matters for large files.
+	bool Open( const char *filename, bool readOnly=false );
+
+	//! Unmaps the file. All pointers to the mapped data become invalid.
+	void Close();
+
+	//! Swaps the mapped files of this object and the given object.
+	void Swap( MappedFile &file ) { char *d=data; size_t s=size; data=file.data; size=file.size; file.data=d; file.size=s; }
+
+	//!@name Access methods
+	bool        IsOpen() const { return data != NULL; }		//!< Returns true if a file is mapped.
+	const char* Data  () const { return data; }				//!< Returns the mapped file data.
+	char*       Data  ()       { return data; }				//!< Returns the mapped file data.
+	size_t      Size  () const { return size; }				//!< Returns the size of the mapped file in bytes.
+
+	//! Returns true if the given pointer points into the mapped file data.
+	bool Contains( const void *p ) const { return data && (const char*)p >= data && (const char*)p < data+size; }
+
+	//!@name File information
+
+	//! Returns the last modification time (in seconds) and the size of the given file.
+	//! Returns false if the file does not exist.
+	static bool GetFileInfo( const char *filename, int64_t &modificationTime, uint64_t &fileSize );
+
+private:
+	char   *data;
+	size_t  size;
+
+	MappedFile( const MappedFile& );				// not copyable
+	MappedFile& operator = ( const MappedFile& );	// not copyable
+};
+
+//-------------------------------------------------------------------------------
+
+inline bool MappedFile::Open( const char *filename, bool readOnly )
+{
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE ) return false;
+	LARGE_INTEGER fileSize;
+	if ( ! GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart <= 0 || uint64_t(fileSize.QuadPart) > uint64_t(SIZE_MAX) ) { CloseHandle(file); return false; }
+	HANDLE mapping = CreateFileMappingA( file, NULL, readOnly ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( ! mapping ) return false;
+	void *p = MapViewOfFile( mapping, readOnly ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0 );
+	CloseHandle( mapping );	// the view keeps the mapping alive
+	if ( ! p ) return false;
+	data = (char*) p;
+	size = (size_t) fileSize.QuadPart;
+#else
+	int fd = open( filename, O_RDONLY );
+	if ( fd < 0 ) return false;
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size <= 0 ) { close(fd); return false; }
+	void *p = mmap( NULL, (size_t) st.st_size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );	// the mapping keeps the file open
+	if ( p == MAP_FAILED ) return false;
+	data = (char*) p;
+	size = (size_t) st.st_size;
+#endif
+	return true;
+}
+
+inline void MappedFile::Close()
+{
+	if ( ! data ) return;
+#ifdef _WIN32
+	UnmapViewOfFile( data );
+#else
+	munmap( data, size );
+#endif
+	data = NULL;
+	size = 0;
+}
+
+inline bool MappedFile::GetFileInfo( const char *filename, int64_t &modificationTime, uint64_t &fileSize )
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if ( _stat64( filename, &st ) != 0 ) return false;
+#else
+	struct stat st;
+	if ( stat( filename, &st ) != 0 ) return false;
+#endif
+	modificationTime = (int64_t) st.st_mtime;
+	fileSize = (uint64_t) st.st_size;
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::MappedFile cyMappedFile;	//!< Memory-mapped file class
+
+//-------------------------------------------------------------------------------
+
+#endif
@@ -1020,7 +1020,7 @@ public:
 		for ( int i=0; i<3; ++i ) b[i] = p[1] * data[3+i];
 		for ( int i=0; i<3; ++i ) c[i] = p[2] * data[6+i];
 		Point3<TYPE> rr;
-		for ( int i=0; i<3; ++i ) rr[i] = a[i] + b[i] + c[i] + data[12+i];	
+		for ( int i=0; i<3; ++i ) rr[i] = a[i] + b[i] + c[i] + data[9+i];	
 		return rr;
 	}
 	Point4<TYPE> operator * ( const Point4<TYPE> &p ) const
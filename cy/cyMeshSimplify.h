@@ -0,0 +1,668 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyMeshSimplify.h
+//! \author Cem Yuksel
+//!
+//! \brief  Quadric error mesh simplification.
+//!
+//! This file includes a class that simplifies triangular meshes by collapsing
+//! edges in the order of their quadric error.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_MESH_SIMPLIFY_H_INCLUDED_
+#define _CY_MESH_SIMPLIFY_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyHeap.h"
+#include "cyMeshAdjacency.h"
+#include "cyTriMesh.h"
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Quadric error mesh simplification.
+//!
+//! Michael Garland and Paul S. Heckbert. 1997. Surface Simplification Using Quadric Error Metrics.
+//! In Proceedings of SIGGRAPH 97, 209-216.
+//!
+//! The edges of the mesh are collapsed in the order of the quadric error of the collapsed vertex,
+//! which is placed at the position that minimizes the error. The quadrics of the vertices are
+//! computed from the planes of their faces, and boundary edges add perpendicular planes
+//! weighted by the boundary weight. A collapse is rejected if it violates the link condition
+//! (which would create non-manifold edges), if it would merge two boundaries through an interior
+//! edge, or if it would flip a face. The edges and the initial vertex faces are found using the
+//! MeshAdjacency class and the faces of each vertex are kept in a linked list of face corners.
+//!
+//! By default, the edges are collapsed one at a time in the order given by a Heap, which is updated
+//! after each collapse. In parallel mode, the edges are collapsed in rounds. The candidate edges
+//! are kept in a list sorted by cost, which is reused by the following rounds. Each round walks
+//! this list, picking the cheapest edges and skipping the edges that have a vertex next to a vertex
+//! of a picked edge. Since the picked edges do not share any faces, they are collapsed in parallel,
+//! and the new costs of the edges around the merged vertices are sorted and merged into the list
+//! for the next round. The outdated entries of the list are skipped using the current edge costs.
+//! When a round cannot collapse enough edges, the remaining collapses are performed in the greedy order.
+//! Parallel mode produces a slightly different result than the greedy order, but both modes
+//! do not depend on the number of threads.
+//!
+//! The simplification keeps the texture and normal indices of the remaining face corners,
+//! so the vertex normals should be recomputed after simplification (see TriMesh::ComputeNormals).
+//!
+//! The memory used during simplification is about 130 bytes per face, 56 of which are used by the
+//! MeshAdjacency structure. Parallel mode uses up to about 190 bytes per face, since it also keeps
+//! the sorted list of the candidate edges.
+//!
+//! The quadrics of the vertices are kept in an array of structures, instead of separate arrays for their
+//! components, because the vertices are accessed in an irregular order and all components of a quadric
+//! are used together. Separate arrays would touch ten cache lines for each vertex, instead of one or two.
+
+class MeshSimplifier
+{
+public:
+	//! The constructor sets the default parameters.
+	MeshSimplifier() : boundaryWeight(1000), parallel(false), maxCollapseError(0) {}
+
+	//! The boundary weight determines how strongly the boundary edges are preserved.
+	//! The quadrics of the boundary vertices include the planes that are perpendicular to the faces
+	//! through the boundary edges, which are multiplied by this weight. The default value is 1000.
+	void SetBoundaryWeight( float weight ) { boundaryWeight = weight; }
+
+	//! Returns the boundary weight.
+	float GetBoundaryWeight() const { return boundaryWeight; }
+
+	//! Parallel mode collapses the edges in rounds of independent collapses, instead of the greedy order.
+	//! Parallel mode is off by default.
+	void SetParallel( bool on=true ) { parallel = on; }
+
+	//! Returns true if parallel mode is turned on.
+	bool IsParallel() const { return parallel; }
+
+	//! Simplifies the given mesh, until the number of faces is not larger than the target face count,
+	//! or until the error of all remaining collapses is larger than the given error limit.
+	//! The error is the square root of the sum of the squared distances of the collapsed vertex to the
+	//! planes of its original faces (and the boundary planes), given in the units of the mesh vertices.
+	//! The deleted faces and the unused vertices are removed from the mesh, keeping the order of the
+	//! remaining faces and the material face ranges. Returns the number of faces of the simplified mesh.
+	unsigned int Simplify( TriMesh &mesh, unsigned int targetFaceCount, float maxError=FLT_MAX );
+
+	//! Returns the largest error of the collapses performed by the last call to Simplify.
+	float GetMaxCollapseError() const { return maxCollapseError; }
+
+private:
+	float boundaryWeight;
+	bool  parallel;
+	float maxCollapseError;
+
+	//! A symmetric quadric matrix, such that the error of point p is p^T A p + 2 b^T p + c.
+	//! The quadric of a vertex is relative to the vertex position. Since the planes of the faces pass through
+	//! or near the vertex, the error of nearby points does not lose its precision to cancellation.
+	struct Quadric
+	{
+		float a00, a01, a02, a11, a12, a22, b0, b1, b2, c;
+		void Zero() { a00=a01=a02=a11=a12=a22=b0=b1=b2=c=0; }
+		void AddPlane( const Point3f &n, float d, float w ) { a00+=w*n.x*n.x; a01+=w*n.x*n.y; a02+=w*n.x*n.z; a11+=w*n.y*n.y; a12+=w*n.y*n.z; a22+=w*n.z*n.z; b0+=w*n.x*d; b1+=w*n.y*d; b2+=w*n.z*d; c+=w*d*d; }
+		void operator += ( const Quadric &q ) { a00+=q.a00; a01+=q.a01; a02+=q.a02; a11+=q.a11; a12+=q.a12; a22+=q.a22; b0+=q.b0; b1+=q.b1; b2+=q.b2; c+=q.c; }
+		//! Moves the origin of the quadric to point t, such that the error of point p becomes the error of point p+t.
+		void Translate( const Point3f &t )
+		{
+			double x=t.x, y=t.y, z=t.z;
+			double ax = a00*x + a01*y + a02*z;
+			double ay = a01*x + a11*y + a12*z;
+			double az = a02*x + a12*y + a22*z;
+			c  = float( c + x*ax + y*ay + z*az + 2*(b0*x + b1*y + b2*z) );
+			b0 = float( b0 + ax );
+			b1 = float( b1 + ay );
+			b2 = float( b2 + az );
+		}
+		float Error( const Point3f &p ) const
+		{
+			double x=p.x, y=p.y, z=p.z;
+			double e = a00*x*x + 2*a01*x*y + 2*a02*x*z + a11*y*y + 2*a12*y*z + a22*z*z + 2*(b0*x + b1*y + b2*z) + c;
+			return e > 0 ? float(e) : 0.0f;
+		}
+		//! Finds the point that minimizes the error. Returns false if the matrix is nearly singular.
+		bool Minimize( Point3f &p ) const
+		{
+			double c00 = double(a11)*a22 - double(a12)*a12;
+			double c01 = double(a02)*a12 - double(a01)*a22;
+			double c02 = double(a01)*a12 - double(a02)*a11;
+			double det = a00*c00 + a01*c01 + a02*c02;
+			double trace = double(a00) + a11 + a22;
+			if ( cyAbs(det) <= 1e-6 * trace*trace*trace ) return false;
+			double c11 = double(a00)*a22 - double(a02)*a02;
+			double c12 = double(a01)*a02 - double(a00)*a12;
+			double c22 = double(a00)*a11 - double(a01)*a01;
+			double s = -1 / det;
+			p.x = float( s * ( c00*b0 + c01*b1 + c02*b2 ) );
+			p.y = float( s * ( c01*b0 + c11*b1 + c12*b2 ) );
+			p.z = float( s * ( c02*b0 + c12*b1 + c22*b2 ) );
+			return true;
+		}
+	};
+
+	// The state of the mesh during simplification
+	TriMesh::TriFace         *faces;
+	std::vector<Point3f>      position;		// The vertex positions, normalized to the unit box.
+	std::vector<Quadric>      quadric;			// The quadric of each vertex, relative to its position.
+	std::vector<unsigned int> firstCorner;		// The first face corner of each vertex in the corner lists.
+	std::vector<unsigned int> lastCorner;		// The last face corner of each vertex in the corner lists.
+	std::vector<unsigned int> nextCorner;		// The next face corner of the same vertex, indexed by face corner (3*face+k).
+	std::vector<unsigned int> edgeVerts;		// The two vertices of each edge, which are updated when a vertex is merged.
+	std::vector<float>        edgeCost;			// The collapse error of each edge.
+	std::vector<char>         boundaryVertex;	// Determines whether the vertex is on a boundary.
+	std::unique_ptr<bool[]>   faceDeleted;		// Determines whether the face is deleted.
+	MeshAdjacency             adjacency;
+	static const unsigned int NONE = 0xFFFFFFFF;
+	static const unsigned int MAX_VERTEX_FACES = 32;	// The maximum number of faces of a collapsed vertex
+
+	void  Initialize( TriMesh &mesh, const Point3f &center, float scale );
+	float CollapseCost( unsigned int a, unsigned int b, Point3f &p ) const;
+	// Returns false if all faces of the edge are deleted. Then, the edge is either collapsed or the edges of its
+	// vertices are represented by the other edges of the remaining faces, which keep the updated costs.
+	// Collapse places both vertices of such edges at the same vertex, so they are skipped by checking their vertices.
+	bool IsEdgeOnFace( unsigned int e ) const { for ( unsigned int i=0; i<adjacency.NumEdgeHalfEdges(e); i++ ) if ( ! faceDeleted[ MeshAdjacency::Face( adjacency.EdgeHalfEdge(e,i) ) ] ) return true; return false; }
+	float EdgeCost( unsigned int e ) const { Point3f p; unsigned int a = edgeVerts[2*e], b = edgeVerts[2*e+1]; return a==b ? FLT_MAX : CollapseCost(a,b,p); }
+	bool  CanCollapse( unsigned int a, unsigned int b, const Point3f &p );
+	unsigned int Collapse( unsigned int a, unsigned int b, const Point3f &p );
+	void  RemoveDeletedCorners( unsigned int v );
+	template <typename BODY> void ForEachEdge( unsigned int v, BODY body ) const;
+	template <typename SET_COST> void UpdateEdgeCosts( unsigned int v, SET_COST setCost ) const;
+	unsigned int SimplifyGreedy  ( unsigned int faceCount, unsigned int targetFaceCount, float errorLimit );
+	unsigned int SimplifyParallel( unsigned int faceCount, unsigned int targetFaceCount, float errorLimit );
+};
+
+//-------------------------------------------------------------------------------
+
+inline unsigned int MeshSimplifier::Simplify( TriMesh &mesh, unsigned int targetFaceCount, float maxError )
+{
+	maxCollapseError = 0;
+	const unsigned int nf = mesh.NF();
+	if ( nf <= targetFaceCount || mesh.NV() == 0 ) return nf;
+
+	// Normalize the positions to the unit box, so that the quadrics can use single precision
+	mesh.ComputeBoundingBox();
+	Point3f center = ( mesh.GetBoundMin() + mesh.GetBoundMax() ) * 0.5f;
+	Point3f size = mesh.GetBoundMax() - mesh.GetBoundMin();
+	float maxSize = size.Max();
+	float scale = maxSize > 0 ? 1.0f / maxSize : 1.0f;
+	Initialize( mesh, center, scale );
+
+	double errorLimit = double(maxError) * scale;
+	errorLimit = errorLimit * errorLimit;
+	float limit = errorLimit < FLT_MAX ? float(errorLimit) : FLT_MAX;
+	unsigned int faceCount = parallel ? SimplifyParallel( nf, targetFaceCount, limit ) : nf;
+	if ( faceCount > targetFaceCount ) faceCount = SimplifyGreedy( faceCount, targetFaceCount, limit );
+	maxCollapseError = cySqrt(maxCollapseError) / scale;
+
+	// Copy the new positions and remove the deleted faces and vertices. The merged vertices are not used by the remaining faces.
+	ParallelFor( 0u, mesh.NV(), [&]( unsigned int i ) { mesh.V(i) = position[i] / scale + center; } );
+	mesh.DeleteFaces( faceDeleted.get() );
+	mesh.DeleteUnusedVertices();
+	if ( mesh.NV() > 0 ) mesh.ComputeBoundingBox();
+
+	// Release the memory
+	position.clear();       position.shrink_to_fit();
+	quadric.clear();        quadric.shrink_to_fit();
+	firstCorner.clear();    firstCorner.shrink_to_fit();
+	lastCorner.clear();     lastCorner.shrink_to_fit();
+	nextCorner.clear();     nextCorner.shrink_to_fit();
+	edgeVerts.clear();      edgeVerts.shrink_to_fit();
+	edgeCost.clear();       edgeCost.shrink_to_fit();
+	boundaryVertex.clear(); boundaryVertex.shrink_to_fit();
+	faceDeleted.reset();
+	adjacency.Clear();
+	faces = NULL;
+	return faceCount;
+}
+
+inline void MeshSimplifier::Initialize( TriMesh &mesh, const Point3f &center, float scale )
+{
+	const unsigned int nv = mesh.NV();
+	const unsigned int nf = mesh.NF();
+	faces = &mesh.F(0);
+	adjacency.Build( mesh );
+	const unsigned int ne = adjacency.NumEdges();
+
+	position.resize( nv );
+	ParallelFor( 0u, nv, [&]( unsigned int i ) { position[i] = ( mesh.V(i) - center ) * scale; } );
+	faceDeleted.reset( new bool[nf] );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) { faceDeleted[i] = false; } );
+
+	// Build the corner lists of the vertices in face order
+	firstCorner.resize( nv );
+	lastCorner.resize( nv );
+	nextCorner.resize( size_t(nf)*3 );
+	ParallelFor( 0u, nv, [&]( unsigned int v ) {
+		unsigned int n = adjacency.NumVertexHalfEdges(v);
+		firstCorner[v] = n > 0 ? adjacency.VertexHalfEdge(v,0)   : NONE;
+		lastCorner [v] = n > 0 ? adjacency.VertexHalfEdge(v,n-1) : NONE;
+		for ( unsigned int i=0; i<n; i++ ) nextCorner[ adjacency.VertexHalfEdge(v,i) ] = i+1 < n ? adjacency.VertexHalfEdge(v,i+1) : NONE;
+	} );
+
+	// Compute the vertex quadrics by gathering the planes of the faces and the boundary edges
+	// The planes are relative to the given origin, which is the position of the vertex of the quadric
+	auto FacePlane = [&]( unsigned int f, const Point3f &origin, Point3f &n, float &d ) {
+		const Point3f &p0 = position[ faces[f].v[0] ];
+		n = ( position[ faces[f].v[1] ] - p0 ) ^ ( position[ faces[f].v[2] ] - p0 );
+		float len = n.Length();
+		if ( len > 0 ) n /= len;
+		d = -( n % ( p0 - origin ) );
+	};
+	auto AddBoundaryPlane = [&]( Quadric &q, unsigned int h, const Point3f &origin ) {
+		Point3f n;
+		float d;
+		FacePlane( MeshAdjacency::Face(h), origin, n, d );
+		const Point3f &p0 = position[ adjacency.Origin(h) ];
+		Point3f edge = position[ adjacency.Target(h) ] - p0;
+		Point3f bn = edge ^ n;
+		float len = bn.Length();
+		if ( len > 0 ) bn /= len;
+		q.AddPlane( bn, -( bn % ( p0 - origin ) ), boundaryWeight );
+	};
+	quadric.resize( nv );
+	boundaryVertex.resize( nv );
+	ParallelFor( 0u, nv, [&]( unsigned int v ) {
+		Quadric &q = quadric[v];
+		q.Zero();
+		bool boundary = false;
+		for ( unsigned int i=0; i<adjacency.NumVertexHalfEdges(v); i++ ) {
+			unsigned int h = adjacency.VertexHalfEdge(v,i);
+			Point3f n;
+			float d;
+			FacePlane( MeshAdjacency::Face(h), position[v], n, d );
+			q.AddPlane( n, d, 1 );
+			if ( adjacency.IsBoundary(h) ) { AddBoundaryPlane( q, h, position[v] ); boundary = true; }
+			unsigned int hp = MeshAdjacency::Prev(h);
+			if ( adjacency.IsBoundary(hp) ) { AddBoundaryPlane( q, hp, position[v] ); boundary = true; }
+		}
+		boundaryVertex[v] = boundary;
+	} );
+
+	// Compute the collapse costs of the edges
+	edgeVerts.resize( size_t(ne)*2 );
+	edgeCost.resize( ne );
+	ParallelFor( 0u, ne, [&]( unsigned int e ) {
+		unsigned int h = adjacency.EdgeHalfEdge(e,0);
+		unsigned int a = adjacency.Origin(h), b = adjacency.Target(h);
+		edgeVerts[2*e] = a;
+		edgeVerts[2*e+1] = b;
+		Point3f p;
+		edgeCost[e] = a==b ? FLT_MAX : CollapseCost(a,b,p);
+	} );
+}
+
+inline float MeshSimplifier::CollapseCost( unsigned int a, unsigned int b, Point3f &p ) const
+{
+	// Combine the quadrics relative to the position of b
+	const Point3f &origin = position[b];
+	Point3f edge = position[a] - origin;
+	Quadric q = quadric[a];
+	q.Translate( -edge );
+	q += quadric[b];
+	if ( q.Minimize(p) ) {
+		// Accept the optimal position only if it is not far from the edge
+		if ( ( p - edge*0.5f ).LengthSquared() <= edge.LengthSquared() ) {
+			float e = q.Error(p);
+			p += origin;
+			return e;
+		}
+	}
+	// Otherwise, use the best of the end points and the middle of the edge
+	Point3f candidates[3] = { position[a], position[b], ( position[a] + position[b] ) * 0.5f };
+	float best = FLT_MAX;
+	for ( int i=0; i<3; i++ ) {
+		float e = q.Error( candidates[i] - origin );
+		if ( e < best ) { best = e; p = candidates[i]; }
+	}
+	return best;
+}
+
+inline void MeshSimplifier::RemoveDeletedCorners( unsigned int v )
+{
+	unsigned int prev = NONE;
+	for ( unsigned int c = firstCorner[v]; c != NONE; c = nextCorner[c] ) {
+		if ( faceDeleted[c/3] ) {
+			if ( prev == NONE ) firstCorner[v] = nextCorner[c];
+			else nextCorner[prev] = nextCorner[c];
+		} else prev = c;
+	}
+	lastCorner[v] = prev;
+}
+
+template <typename BODY>
+inline void MeshSimplifier::ForEachEdge( unsigned int v, BODY body ) const
+{
+	// Each face corner of the vertex has an outgoing and an incoming half-edge
+	for ( unsigned int c = firstCorner[v]; c != NONE; c = nextCorner[c] ) {
+		if ( faceDeleted[c/3] ) continue;
+		body( adjacency.Edge(c) );
+		body( adjacency.Edge( MeshAdjacency::Prev(c) ) );
+	}
+}
+
+template <typename SET_COST>
+inline void MeshSimplifier::UpdateEdgeCosts( unsigned int v, SET_COST setCost ) const
+{
+	// A merged vertex keeps the edges of both vertices, so it can have two edges to the same neighbor.
+	// The cost is computed once for each neighbor and the other edges to the same neighbor get FLT_MAX.
+	// The merged vertex has at most MAX_VERTEX_FACES faces, so its edges fit in a small array.
+	unsigned int neighbors[ 2*MAX_VERTEX_FACES ], edges[ 2*MAX_VERTEX_FACES ], count = 0;
+	ForEachEdge( v, [&]( unsigned int e ) {
+		unsigned int n = edgeVerts[2*e] ^ edgeVerts[2*e+1] ^ v;
+		unsigned int i = 0;
+		while ( i < count && neighbors[i] != n ) i++;
+		if ( i < count ) {
+			if ( edges[i] != e ) setCost( e, FLT_MAX );
+			return;
+		}
+		if ( count < 2*MAX_VERTEX_FACES ) { neighbors[count] = n; edges[count] = e; count++; }
+		setCost( e, EdgeCost(e) );
+	} );
+}
+
+inline bool MeshSimplifier::CanCollapse( unsigned int a, unsigned int b, const Point3f &p )
+{
+	RemoveDeletedCorners(a);
+	RemoveDeletedCorners(b);
+
+	// Checks if the face of vertex v with the other vertices v1 and v2 flips when v is moved to p
+	auto Flips = [&]( unsigned int v, unsigned int v1, unsigned int v2 ) {
+		Point3f n0 = ( position[v1] - position[v] ) ^ ( position[v2] - position[v] );
+		Point3f n1 = ( position[v1] - p ) ^ ( position[v2] - p );
+		return n0 % n1 <= 0 && n0.LengthSquared() > 0;	// degenerate faces cannot flip
+	};
+
+	// Collect the neighbors of a through the faces that do not include b and the opposite vertices of the shared faces.
+	// The number of faces is limited, so that the neighbors fit in a small array.
+	unsigned int neighbors[ 2*MAX_VERTEX_FACES ], neighborCount = 0, opposite[2], sharedFaces = 0;
+	for ( unsigned int c = firstCorner[a]; c != NONE; c = nextCorner[c] ) {
+		const TriMesh::TriFace &face = faces[c/3];
+		unsigned int k = c % 3;
+		unsigned int v1 = face.v[ (k+1) % 3 ], v2 = face.v[ (k+2) % 3 ];
+		if ( v1 == b || v2 == b ) {
+			if ( sharedFaces < 2 ) opposite[sharedFaces] = v1 == b ? v2 : v1;
+			sharedFaces++;
+			continue;
+		}
+		// Avoid creating vertices with too many faces, which would make the following collapses expensive
+		if ( neighborCount == 2*MAX_VERTEX_FACES ) return false;
+		if ( Flips( a, v1, v2 ) ) return false;
+		neighbors[ neighborCount++ ] = v1;
+		neighbors[ neighborCount++ ] = v2;
+	}
+
+	// The edge must have one or two faces, and two boundary vertices can only be merged through a boundary edge
+	if ( sharedFaces == 0 || sharedFaces > 2 ) return false;
+	if ( boundaryVertex[a] && boundaryVertex[b] && sharedFaces != 1 ) return false;
+	if ( sharedFaces == 2 && opposite[0] == opposite[1] ) return false;
+
+	// Link condition: the common neighbors of the two vertices must be the opposite vertices of the shared faces
+	auto IsCommonNeighbor = [&]( unsigned int v ) {
+		if ( v == opposite[0] || ( sharedFaces == 2 && v == opposite[1] ) ) return false;
+		for ( unsigned int i=0; i<neighborCount; i++ ) if ( neighbors[i] == v ) return true;
+		return false;
+	};
+	unsigned int faceCount = neighborCount / 2;
+	for ( unsigned int c = firstCorner[b]; c != NONE; c = nextCorner[c] ) {
+		const TriMesh::TriFace &face = faces[c/3];
+		unsigned int k = c % 3;
+		unsigned int v1 = face.v[ (k+1) % 3 ], v2 = face.v[ (k+2) % 3 ];
+		if ( v1 == a || v2 == a ) continue;
+		if ( ++faceCount > MAX_VERTEX_FACES ) return false;
+		if ( Flips( b, v1, v2 ) ) return false;
+		if ( IsCommonNeighbor(v1) || IsCommonNeighbor(v2) ) return false;
+	}
+	return true;
+}
+
+inline unsigned int MeshSimplifier::Collapse( unsigned int a, unsigned int b, const Point3f &p )
+{
+	// Merge vertex a into vertex b, moving the origins of the quadrics to the new position
+	Quadric qa = quadric[a];
+	qa.Translate( p - position[a] );
+	quadric[b].Translate( p - position[b] );
+	quadric[b] += qa;
+	position[b] = p;
+	boundaryVertex[b] |= boundaryVertex[a];
+
+	// Delete the shared faces and move the other faces of a to b, along with the edges of a on these faces.
+	// Both vertices of the edges that are no longer on any face are set to b, so that they are not collapsed.
+	unsigned int deleted = 0;
+	for ( unsigned int c = firstCorner[a]; c != NONE; ) {
+		unsigned int next = nextCorner[c];
+		TriMesh::TriFace &face = faces[c/3];
+		if ( face.v[0] == b || face.v[1] == b || face.v[2] == b ) {
+			faceDeleted[c/3] = true;
+			deleted++;
+			for ( unsigned int h=c-c%3; h<c-c%3+3; h++ ) {
+				unsigned int e = adjacency.Edge(h);
+				if ( ! IsEdgeOnFace(e) ) edgeVerts[2*e] = edgeVerts[2*e+1] = b;
+			}
+		} else {
+			face.v[c%3] = b;
+			unsigned int e[2] = { adjacency.Edge(c), adjacency.Edge( MeshAdjacency::Prev(c) ) };
+			for ( int j=0; j<4; j++ ) if ( edgeVerts[ 2*e[j/2] + j%2 ] == a ) edgeVerts[ 2*e[j/2] + j%2 ] = b;
+			nextCorner[c] = NONE;
+			if ( lastCorner[b] == NONE ) firstCorner[b] = c;
+			else nextCorner[ lastCorner[b] ] = c;
+			lastCorner[b] = c;
+		}
+		c = next;
+	}
+	firstCorner[a] = lastCorner[a] = NONE;
+	RemoveDeletedCorners(b);
+	return deleted;
+}
+
+inline unsigned int MeshSimplifier::SimplifyGreedy( unsigned int faceCount, unsigned int targetFaceCount, float errorLimit )
+{
+	const unsigned int ne = (unsigned int) edgeCost.size();
+	MinHeap< float, unsigned int > heap;	// the edge with the smallest cost is at the top
+	heap.SetDataPointer( edgeCost.data(), ne );
+	heap.Build();
+
+	while ( faceCount > targetFaceCount && heap.NumItemsInHeap() > 0 ) {
+		unsigned int e = heap.GetTopItemID();
+		float cost = edgeCost[e];
+		if ( cost >= FLT_MAX || cost > errorLimit ) break;
+		unsigned int a = edgeVerts[2*e], b = edgeVerts[2*e+1];
+		if ( a == b ) { heap.Pop(); continue; }
+		if ( a < b ) std::swap( a, b );	// keep the vertex with the smaller index
+		Point3f p;
+		CollapseCost( a, b, p );
+		if ( ! CanCollapse( a, b, p ) ) {
+			// Keep the edge in the heap, so that it can be collapsed after its neighborhood changes
+			edgeCost[e] = FLT_MAX;
+			heap.MoveItemDown(e);
+			continue;
+		}
+		heap.Pop();
+		faceCount -= Collapse( a, b, p );
+		if ( cost > maxCollapseError ) maxCollapseError = cost;
+
+		// Update the costs of the edges of the merged vertex
+		UpdateEdgeCosts( b, [&]( unsigned int edge, float newCost ) { if ( heap.IsInHeap(edge) ) heap.SetItem( edge, newCost ); } );
+	}
+	return faceCount;
+}
+
+inline unsigned int MeshSimplifier::SimplifyParallel( unsigned int faceCount, unsigned int targetFaceCount, float errorLimit )
+{
+	// The candidate edges are kept in a list that is sorted by their keys, which combine the bits of the costs and the edge indices.
+	// The bits of non-negative floats have the same order as the floats, so the keys are sorted by cost and then by edge.
+	// When the cost of an edge changes, the edge is added to the list with its new key, and its old key is skipped.
+	auto Key = []( float cost, unsigned int e ) { uint32_t bits; memcpy( &bits, &cost, sizeof(bits) ); return ( uint64_t(bits) << 32 ) | e; };
+	auto IsCandidate = [errorLimit]( float cost ) { return cost < FLT_MAX && cost <= errorLimit; };
+	auto IsCurrent = [&]( uint64_t key ) { unsigned int e = (unsigned int)( key & 0xFFFFFFFF ); return Key( edgeCost[e], e ) == key; };
+	auto IsRemoved = [&]( uint64_t key ) { unsigned int e = (unsigned int)( key & 0xFFFFFFFF ); return edgeVerts[2*e] == edgeVerts[2*e+1]; };
+
+	// Each range collects the keys in order, so concatenating them keeps the order of the keys within the ranges
+	std::vector< std::vector<uint64_t> > rangeKeys;
+	auto GatherKeys = [&]( std::vector<uint64_t> &keys, int rangeCount ) {
+		keys.clear();
+		for ( int r=0; r<rangeCount; r++ ) keys.insert( keys.end(), rangeKeys[r].begin(), rangeKeys[r].end() );
+	};
+
+	const unsigned int nv = (unsigned int) position.size();
+	const unsigned int ne = (unsigned int) edgeCost.size();
+	const uint64_t NO_EDGE = ~uint64_t(0);
+	std::vector<uint64_t> candidates, updated, merged, windowVerts;
+	int rangeCount = ParallelRangeCount( ne );
+	rangeKeys.resize( rangeCount );
+	ParallelForRanges( 0u, ne, rangeCount, [&]( int r, unsigned int rangeBegin, unsigned int rangeEnd ) {
+		for ( unsigned int e=rangeBegin; e<rangeEnd; e++ ) if ( IsCandidate( edgeCost[e] ) ) rangeKeys[r].push_back( Key( edgeCost[e], e ) );
+	} );
+	GatherKeys( candidates, rangeCount );
+	for ( std::vector<uint64_t> &keys : rangeKeys ) std::vector<uint64_t>().swap( keys );	// the following rounds collect fewer keys
+	ParallelSort( candidates.begin(), candidates.end() );
+
+	std::vector<uint64_t> collapses;
+	std::vector<unsigned int> lockRound( nv, 0 );
+	std::vector<float> rangeMaxError;
+	for ( unsigned int round=1; faceCount > targetFaceCount; round++ ) {
+		// Remove the old keys and the removed edges when they may be the majority of the list (a manifold mesh has about 3/2 edges per face)
+		if ( candidates.size() > 3 * size_t(faceCount) ) {
+			rangeCount = ParallelRangeCount( candidates.size() );
+			if ( rangeKeys.size() < size_t(rangeCount) ) rangeKeys.resize( rangeCount );
+			ParallelForRanges( size_t(0), candidates.size(), rangeCount, [&]( int r, size_t rangeBegin, size_t rangeEnd ) {
+				rangeKeys[r].clear();
+				for ( size_t i=rangeBegin; i<rangeEnd; i++ ) if ( IsCurrent( candidates[i] ) && ! IsRemoved( candidates[i] ) ) rangeKeys[r].push_back( candidates[i] );
+			} );
+			GatherKeys( candidates, rangeCount );
+		}
+
+		// Merge the updated keys into the list and pick the cheapest edges in the order of their costs, such that the vertices
+		// of the picked edges are not adjacent, by locking the neighbors of their vertices. Therefore, the collapses do not
+		// share any faces. Since each collapse deletes about two faces, each round considers as many edges as the collapses
+		// that are needed. The considered edges that are not picked are kept in the list for the next round.
+		merged.resize( candidates.size() + updated.size() );
+		std::merge( candidates.begin(), candidates.end(), updated.begin(), updated.end(), merged.begin() );
+		candidates.swap( merged );
+		const size_t count = size_t( faceCount - targetFaceCount + 1 ) / 2;
+		size_t considered = 0, kept = 0, i = 0;
+		uint64_t lastKey = ~uint64_t(0);
+		collapses.clear();
+		while ( considered < count && i < candidates.size() ) {
+			// The outdated keys are skipped and the vertices of the edges are found in parallel for a window of the list,
+			// which is twice as large as the number of edges that are needed, since many keys can be outdated.
+			const size_t windowBegin = i;
+			const size_t windowEnd = std::min( candidates.size(), i + 2*( count - considered ) );
+			windowVerts.resize( windowEnd - windowBegin );
+			ParallelFor( windowBegin, windowEnd, [&]( size_t k ) {
+				uint64_t key = candidates[k];
+				unsigned int e = (unsigned int)( key & 0xFFFFFFFF );
+				windowVerts[ k - windowBegin ] = IsCurrent( key ) && ! IsRemoved( key ) ? ( uint64_t( edgeVerts[2*e] ) << 32 ) | edgeVerts[2*e+1] : NO_EDGE;
+			} );
+			for ( ; i<windowEnd && considered<count; i++ ) {
+				uint64_t key = candidates[i];
+				if ( key == lastKey ) continue;	// an edge can be updated to the same cost
+				lastKey = key;
+				uint64_t verts = windowVerts[ i - windowBegin ];
+				if ( verts == NO_EDGE ) continue;
+				considered++;
+				unsigned int a = (unsigned int)( verts >> 32 ), b = (unsigned int)( verts & 0xFFFFFFFF );
+				if ( lockRound[a] == round || lockRound[b] == round ) { candidates[ kept++ ] = key; continue; }
+				collapses.push_back( ( uint64_t( a < b ? a : b ) << 32 ) | ( key & 0xFFFFFFFF ) );
+				unsigned int v[2] = { a, b };
+				for ( int k=0; k<2; k++ ) {
+					for ( unsigned int c = firstCorner[v[k]]; c != NONE; c = nextCorner[c] ) {
+						if ( faceDeleted[c/3] ) continue;
+						const TriMesh::TriFace &face = faces[c/3];
+						lockRound[ face.v[0] ] = lockRound[ face.v[1] ] = lockRound[ face.v[2] ] = round;
+					}
+				}
+			}
+		}
+		candidates.erase( candidates.begin() + kept, candidates.begin() + i );
+		if ( considered == 0 ) break;
+
+		// Collapse the picked edges in parallel and update the costs of the edges of the merged vertices.
+		// The locked neighborhoods of the collapses do not overlap, so each collapse only changes its own edges.
+		// Therefore, the collapses can be performed in any order. They are sorted by the merged vertices,
+		// since the nearby vertices of the mesh are often stored nearby in memory.
+		ParallelSort( collapses.begin(), collapses.end() );
+		const unsigned int collapseCount = (unsigned int) collapses.size();
+		std::atomic<unsigned int> deletedFaces(0);
+		rangeCount = ParallelRangeCount( collapseCount );
+		if ( rangeKeys.size() < size_t(rangeCount) ) rangeKeys.resize( rangeCount );
+		rangeMaxError.assign( rangeCount, 0.0f );
+		ParallelForRanges( 0u, collapseCount, rangeCount, [&]( int r, unsigned int rangeBegin, unsigned int rangeEnd ) {
+			std::vector<uint64_t> &keys = rangeKeys[r];
+			keys.clear();
+			unsigned int deleted = 0;
+			for ( unsigned int i=rangeBegin; i<rangeEnd; i++ ) {
+				unsigned int e = (unsigned int)( collapses[i] & 0xFFFFFFFF );
+				unsigned int a = edgeVerts[2*e], b = edgeVerts[2*e+1];
+				if ( a < b ) std::swap( a, b );	// keep the vertex with the smaller index
+				float cost = edgeCost[e];
+				edgeCost[e] = FLT_MAX;
+				Point3f p;
+				CollapseCost( a, b, p );
+				if ( ! CanCollapse( a, b, p ) ) continue;
+				deleted += Collapse( a, b, p );
+				if ( cost > rangeMaxError[r] ) rangeMaxError[r] = cost;
+				UpdateEdgeCosts( b, [&]( unsigned int edge, float newCost ) {
+					edgeCost[edge] = newCost;
+					if ( IsCandidate( newCost ) ) keys.push_back( Key( newCost, edge ) );
+				} );
+			}
+			deletedFaces.fetch_add( deleted, std::memory_order_relaxed );
+		} );
+		GatherKeys( updated, rangeCount );
+		ParallelSort( updated.begin(), updated.end() );
+		for ( float error : rangeMaxError ) if ( error > maxCollapseError ) maxCollapseError = error;
+		const unsigned int remainingFaceCount = faceCount - targetFaceCount;
+		const unsigned int deletedFaceCount = deletedFaces.load();
+		faceCount -= deletedFaceCount;
+
+		// When most collapses are rejected, the remaining collapses are left to the greedy order,
+		// which skips the rejected edges without considering the same edges in each round.
+		if ( size_t(deletedFaceCount) * 128 < remainingFaceCount ) break;
+	}
+	return faceCount;
+}
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::MeshSimplifier cyMeshSimplifier;	//!< Quadric error mesh simplification
+
+//-------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,284 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyMultiQueue.h
+//! \author Cem Yuksel
+//!
+//! \brief  A concurrent relaxed priority queue
+//!
+//! This file includes a concurrent priority queue class that keeps multiple
+//! locked heaps and pops from the better one of two randomly picked heaps.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_MULTI_QUEUE_H_INCLUDED_
+#define _CY_MULTI_QUEUE_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyHeap.h"
+#include <assert.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! A concurrent relaxed priority queue that allows updates by item id.
+//!
+//! The items are distributed to multiple heaps (Heap class) by their ids, each protected by its own lock.
+//! The Pop method picks two heaps at random and removes the top item of the heap with the higher priority,
+//! so multiple threads rarely wait for the same lock. The popped item is not necessarily the item with
+//! the highest priority, but it is close to the top of the queue. The expected rank error grows with
+//! the number of heaps. This relaxed ordering is suitable for parallelizing greedy algorithms, such as
+//! sample elimination or mesh decimation, that can tolerate processing items slightly out of order.
+//!
+//! Since each item id always belongs to the same heap, the priority of an item can be updated
+//! (decrease-key) from any thread by locking only its heap. The COMPARE function object determines
+//! the order of the items, as with the Heap class, and a comparator with state can be given to the
+//! constructor, which is copied to all heaps. The item type must be trivially copyable,
+//! such as float or double, since the top item of each heap is kept in an atomic variable.
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t, typename COMPARE=std::less<DATA_TYPE>>
+class MultiQueue
+{
+	static_assert( std::is_trivially_copyable<DATA_TYPE>::value, "MultiQueue requires a trivially copyable item type." );
+public:
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Constructor and Destructor
+
+	MultiQueue( const COMPARE &comp=COMPARE() ) : queues(nullptr), queueCount(0), size(0), itemCount(0), compare(comp) {}
+	~MultiQueue() { Clear(); }
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Initialization methods
+
+	//! Deletes all data.
+	void Clear()
+	{
+		for ( int q=0; q<queueCount; q++ ) queues[q].~Queue();
+		queueBuffer.reset();
+		queues = nullptr;
+		queueCount = 0;
+		size = 0;
+		itemCount = 0;
+	}
+
+	//! Builds the queue by copying the given items. The id of an item is its index in the given array.
+	//! The items are distributed to the given number of heaps. If the heap count is zero (or negative),
+	//! four heaps are used per thread (see ParallelThreadCount). The heaps are built in parallel.
+	//! This method is not thread-safe.
+	void Build( const DATA_TYPE *items, SIZE_TYPE count, int heapCount=0 )
+	{
+		Clear();
+		if ( heapCount <= 0 ) heapCount = 4 * ParallelThreadCount();
+		if ( SIZE_TYPE(heapCount) > count ) heapCount = count > 0 ? int(count) : 1;
+		// The heaps are placed in a buffer aligned to the cache line size, since new[] does not
+		// guarantee the alignment of Queue before C++17.
+		queueBuffer.reset( new char[ sizeof(Queue)*heapCount + CACHE_LINE_SIZE - 1 ] );
+		queues = (Queue*) ( ( uintptr_t(queueBuffer.get()) + CACHE_LINE_SIZE - 1 ) & ~uintptr_t(CACHE_LINE_SIZE - 1) );
+		for ( int q=0; q<heapCount; q++ ) new (queues+q) Queue( compare );
+		queueCount = heapCount;
+		size = count;
+		ParallelForRanges( 0, queueCount, queueCount, [&]( int, int rangeBegin, int rangeEnd ) {
+			for ( int q=rangeBegin; q<rangeEnd; q++ ) {
+				Queue &queue = queues[q];
+				SIZE_TYPE n = ( count + SIZE_TYPE(queueCount-1) - SIZE_TYPE(q) ) / SIZE_TYPE(queueCount);
+				queue.items.resize( n );
+				for ( SIZE_TYPE i=0; i<n; i++ ) queue.items[i] = items[ i*queueCount + q ];
+				queue.heap.SetDataPointer( queue.items.data(), n );
+				queue.heap.Build();
+				queue.UpdateTop();
+			}
+		} );
+		itemCount = count;
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Access and manipulation methods
+
+	//! Removes an item close to the top of the queue and returns its id and value.
+	//! Returns false if the queue is empty. This method is thread-safe.
+	bool Pop( SIZE_TYPE &id, DATA_TYPE &item )
+	{
+		while ( itemCount.load( std::memory_order_acquire ) > 0 ) {
+			int q = PickQueue();
+			if ( q < 0 ) continue;
+			Queue &queue = queues[q];
+			std::unique_lock<std::mutex> lock( queue.mutex, std::try_to_lock );
+			if ( ! lock.owns_lock() || queue.heap.NumItemsInHeap() == 0 ) continue;
+			SIZE_TYPE localID = queue.heap.GetTopItemID();
+			queue.heap.Pop( item );
+			queue.UpdateTop();
+			itemCount.fetch_sub( 1, std::memory_order_release );
+			id = localID * SIZE_TYPE(queueCount) + SIZE_TYPE(q);
+			return true;
+		}
+		return false;
+	}
+
+	//! Removes an item close to the top of the queue and returns its id.
+	//! Returns false if the queue is empty. This method is thread-safe.
+	bool Pop( SIZE_TYPE &id ) { DATA_TYPE item; return Pop( id, item ); }
+
+	//! Sets the item with the given id and updates its position in its heap.
+	//! Returns false if the item is not in the queue anymore (removed by Pop).
+	//! This method is thread-safe.
+	bool SetItem( SIZE_TYPE id, const DATA_TYPE &item )
+	{
+		assert( id < size );
+		Queue &queue = queues[ id % SIZE_TYPE(queueCount) ];
+		SIZE_TYPE localID = id / SIZE_TYPE(queueCount);
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if ( ! queue.heap.IsInHeap( localID ) ) return false;
+		queue.heap.SetItem( localID, item );
+		queue.UpdateTop();
+		return true;
+	}
+
+	//! Modifies the item with the given id by calling the given function with a reference to the item,
+	//! and updates its position in its heap. The function is called while the heap of the item is locked,
+	//! so that concurrent modifications, such as subtracting a weight, are not lost.
+	//! Returns false if the item is not in the queue anymore (removed by Pop), without calling the function.
+	//! This method is thread-safe.
+	template <typename MODIFY>
+	bool ModifyItem( SIZE_TYPE id, MODIFY modify )
+	{
+		assert( id < size );
+		Queue &queue = queues[ id % SIZE_TYPE(queueCount) ];
+		SIZE_TYPE localID = id / SIZE_TYPE(queueCount);
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if ( ! queue.heap.IsInHeap( localID ) ) return false;
+		modify( queue.items[localID] );
+		queue.heap.MoveItem( localID );
+		queue.UpdateTop();
+		return true;
+	}
+
+	//! Returns the item with the given id. This method is thread-safe.
+	DATA_TYPE GetItem( SIZE_TYPE id )
+	{
+		assert( id < size );
+		Queue &queue = queues[ id % SIZE_TYPE(queueCount) ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		return queue.items[ id / SIZE_TYPE(queueCount) ];
+	}
+
+	//! Returns if the item with the given id is in the queue or removed by Pop. This method is thread-safe.
+	bool IsInQueue( SIZE_TYPE id )
+	{
+		assert( id < size );
+		Queue &queue = queues[ id % SIZE_TYPE(queueCount) ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		return queue.heap.IsInHeap( id / SIZE_TYPE(queueCount) );
+	}
+
+	//! Returns the number of items in the queue.
+	SIZE_TYPE NumItemsInQueue() const { return itemCount.load(); }
+
+	//! Returns the number of heaps.
+	int NumHeaps() const { return queueCount; }
+
+private:
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Internal structures and methods
+
+	enum { CACHE_LINE_SIZE = 64 };
+
+	// A heap with its own lock, padded to a cache line to avoid false sharing.
+	struct alignas(CACHE_LINE_SIZE) Queue {
+		std::mutex                       mutex;
+		Heap<DATA_TYPE,SIZE_TYPE,COMPARE> heap;
+		std::vector<DATA_TYPE>           items;		// The items of this heap, indexed by their local ids.
+		std::atomic<DATA_TYPE>           top;		// A copy of the top item, read without locking.
+		std::atomic<bool>                empty;		// Determines whether the heap is empty.
+		Queue( const COMPARE &comp ) : heap(comp), empty(true) {}
+		// Updates the top item copy. Must be called while the heap is locked.
+		void UpdateTop()
+		{
+			bool e = heap.NumItemsInHeap() == 0;
+			if ( !e ) top.store( heap.GetTopItem(), std::memory_order_relaxed );
+			empty.store( e, std::memory_order_release );
+		}
+	};
+
+	std::unique_ptr<char[]>  queueBuffer;	// The memory of the heaps.
+	Queue                   *queues;		// The heaps, aligned to the cache line size.
+	int                      queueCount;	// The number of heaps.
+	SIZE_TYPE                size;			// The total item count, including the ones removed from the queue.
+	std::atomic<SIZE_TYPE>   itemCount;		// The number of items in the queue.
+	COMPARE                  compare;		// The comparison function object.
+
+	// Picks two heaps at random and returns the one with the higher priority top item.
+	// Returns -1 if both heaps are empty.
+	int PickQueue()
+	{
+		int q1 = int( Random() % uint32_t(queueCount) );
+		int q2 = int( Random() % uint32_t(queueCount) );
+		bool e1 = queues[q1].empty.load( std::memory_order_acquire );
+		bool e2 = queues[q2].empty.load( std::memory_order_acquire );
+		if ( e1 ) return e2 ? -1 : q2;
+		if ( e2 ) return q1;
+		DATA_TYPE t1 = queues[q1].top.load( std::memory_order_relaxed );
+		DATA_TYPE t2 = queues[q2].top.load( std::memory_order_relaxed );
+		return compare( t1, t2 ) ? q2 : q1;
+	}
+
+	// Returns a random number using a per-thread xorshift generator.
+	static uint32_t Random()
+	{
+		static thread_local uint32_t state = 0;
+		if ( state == 0 ) {
+			state = uint32_t( std::hash<std::thread::id>()( std::this_thread::get_id() ) ) | 1u;
+		}
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	MultiQueue( const MultiQueue& );				// not copyable
+	MultiQueue& operator = ( const MultiQueue& );	// not copyable
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+};
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+template <typename DATA_TYPE, typename SIZE_TYPE=size_t, typename COMPARE=std::less<DATA_TYPE>> using cyMultiQueue = cy::MultiQueue<DATA_TYPE,SIZE_TYPE,COMPARE>;	//!< Concurrent relaxed priority queue
+
+//-------------------------------------------------------------------------------
+
+#endif
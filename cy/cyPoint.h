@@ -234,7 +234,7 @@ public:
 
 	//!@name Test operators
 	bool operator == ( const Point2& p ) const { return x==p.x && y==p.y; }
-	bool operator != ( const Point2& p ) const { return x!=p.x && y!=p.y; }
+	bool operator != ( const Point2& p ) const { return x!=p.x || y!=p.y; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
@@ -332,7 +332,7 @@ public:
 
 	//!@name Test operators
 	bool operator == ( const Point3& p ) const { return x==p.x && y==p.y && z==p.z; }
-	bool operator != ( const Point3& p ) const { return x!=p.x && y!=p.y && z!=p.z; }
+	bool operator != ( const Point3& p ) const { return x!=p.x || y!=p.y || z!=p.z; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
@@ -433,7 +433,7 @@ public:
 
 	//!@name Test operators
 	bool operator == ( const Point4& p ) const { return x==p.x && y==p.y && z==p.z && w==p.w; }
-	bool operator != ( const Point4& p ) const { return x!=p.x && y!=p.y && z!=p.z && w!=p.w; }
+	bool operator != ( const Point4& p ) const { return x!=p.x || y!=p.y || z!=p.z || w!=p.w; }
 
 	//!@name Access operators
 	TYPE&       operator [] ( int i )       { return Element(i); }
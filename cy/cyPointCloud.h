@@ -45,8 +45,10 @@
 
 //-------------------------------------------------------------------------------
 
+#include "cyCore.h"
 #include <assert.h>
 #include <algorithm>
+#include <limits>
 #include <stdint.h>
 
 //-------------------------------------------------------------------------------
@@ -99,34 +101,27 @@ public:
 	template <typename _CALLBACK>
 	void GetPoints( const PointType &position, FType radius, _CALLBACK pointFound )
 	{
-		SIZE_TYPE internalNodes = (pointCount+1) >> 1;
-		SIZE_TYPE stack[60];	// deep enough for 2^30 points
-		int stackPos = 0;
-		stack[0] = 1;	// root node
 		FType dist2 = radius * radius;
-		while ( stackPos >= 0 ) {
-			SIZE_TYPE ix = stack[ stackPos-- ];
-			const PointData *p = &points[ix];
-			const PointType pos = p->Pos();
-			if ( ix < internalNodes ) {
-				int axis = p->Plane();
-				FType d = position[axis] - pos[axis];
-				if( d > 0 ) {	// if dist1 is positive search right child first
-					stack[++stackPos] = 2*ix + 1;
-					if ( d*d < dist2 ) stack[++stackPos] = 2*ix;
-				} else {	// dist1 is negative, search left child first
-					stack[++stackPos] = 2*ix;
-					if ( d*d < dist2 ) stack[++stackPos] = 2*ix + 1;
-				}
-			}
-			FType d2 = (pos - position).LengthSquared();
-			if ( d2 < dist2 ) pointFound( p->Index(), pos, d2, dist2 );
-		}
-		if ( (pointCount & SIZE_TYPE(1)) == 0 ) {
-			const PointData *p = &points[pointCount];
-			FType d2 = (p->Pos() - position).LengthSquared();
-			if ( d2 < dist2 ) pointFound( p->Index(), p->Pos(), d2, dist2 );
-		}
+		TraverseKDTree( position, dist2, pointFound );
+	}
+
+	//! Returns all points to the given position within the given radius in a periodic (toroidal) domain.
+	//! Calls the given pointFound function for each point found.
+	//!
+	//! The domain repeats between domainMin and domainMax along each axis where domainMax is greater
+	//! than domainMin. Along the other axes distances are not wrapped. The points must be inside the domain.
+	//! Instead of keeping copies of the points near the domain boundaries, the tree is searched with
+	//! a shifted copy of the given position for each combination of the boundaries within the radius.
+	//! The position sent to the pointFound function is the periodic image of the point
+	//! that is closest to the given position, so it can be outside of the domain.
+	//! The callback function has the same form as the one used by the GetPoints method.
+	template <typename _CALLBACK>
+	void GetPointsPeriodic( const PointType &position, FType radius, const PointType &domainMin, const PointType &domainMax, _CALLBACK pointFound )
+	{
+		FType dist2 = radius * radius;
+		PointType shift = position;
+		for ( uint32_t d=0; d<DIMENSIONS; d++ ) shift[d] = FType(0);
+		TraversePeriodic( position, radius, domainMin, domainMax, shift, 0, dist2, pointFound );
 	}
 
 	//! Used by one of the PointCloud::GetPoints() methods.
@@ -348,6 +343,421 @@ private:
 		return axis;
 	}
 
+	// Traverses the k-d tree for the GetPoints methods. The callback can reduce dist2.
+	template <typename _CALLBACK>
+	void TraverseKDTree( const PointType &position, FType &dist2, _CALLBACK &pointFound ) const
+	{
+		SIZE_TYPE internalNodes = (pointCount+1) >> 1;
+		SIZE_TYPE stack[60];	// deep enough for 2^30 points
+		int stackPos = 0;
+		stack[0] = 1;	// root node
+		while ( stackPos >= 0 ) {
+			SIZE_TYPE ix = stack[ stackPos-- ];
+			const PointData *p = &points[ix];
+			const PointType pos = p->Pos();
+			if ( ix < internalNodes ) {
+				int axis = p->Plane();
+				FType d = position[axis] - pos[axis];
+				if( d > 0 ) {	// if dist1 is positive search right child first
+					stack[++stackPos] = 2*ix + 1;
+					if ( d*d < dist2 ) stack[++stackPos] = 2*ix;
+				} else {	// dist1 is negative, search left child first
+					stack[++stackPos] = 2*ix;
+					if ( d*d < dist2 ) stack[++stackPos] = 2*ix + 1;
+				}
+			}
+			FType d2 = (pos - position).LengthSquared();
+			if ( d2 < dist2 ) pointFound( p->Index(), pos, d2, dist2 );
+		}
+		if ( (pointCount & SIZE_TYPE(1)) == 0 ) {
+			const PointData *p = &points[pointCount];
+			FType d2 = (p->Pos() - position).LengthSquared();
+			if ( d2 < dist2 ) pointFound( p->Index(), p->Pos(), d2, dist2 );
+		}
+	}
+
+	// Recursively picks the shift along each periodic axis and traverses the k-d tree with the shifted position.
+	// A point found with a shifted position is sent to the callback at its image around the original position.
+	template <typename _CALLBACK>
+	void TraversePeriodic( const PointType &position, FType radius, const PointType &domainMin, const PointType &domainMax, PointType &shift, uint32_t axis, FType &dist2, _CALLBACK &pointFound ) const
+	{
+		if ( axis == DIMENSIONS ) {
+			bool shifted = false;
+			for ( uint32_t d=0; d<DIMENSIONS; d++ ) shifted |= ( shift[d] != FType(0) );
+			if ( shifted ) {
+				PointType p = position + shift;
+				auto shiftedPointFound = [&]( SIZE_TYPE i, const PointType &pos, FType d2, FType &r2 ) { pointFound( i, pos - shift, d2, r2 ); };
+				TraverseKDTree( p, dist2, shiftedPointFound );
+			} else {
+				TraverseKDTree( position, dist2, pointFound );
+			}
+			return;
+		}
+		TraversePeriodic( position, radius, domainMin, domainMax, shift, axis+1, dist2, pointFound );
+		FType size = domainMax[axis] - domainMin[axis];
+		if ( size > FType(0) ) {
+			if ( position[axis] - radius < domainMin[axis] ) {
+				shift[axis] = size;
+				TraversePeriodic( position, radius, domainMin, domainMax, shift, axis+1, dist2, pointFound );
+			}
+			if ( position[axis] + radius > domainMax[axis] ) {
+				shift[axis] = -size;
+				TraversePeriodic( position, radius, domainMin, domainMax, shift, axis+1, dist2, pointFound );
+			}
+			shift[axis] = FType(0);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+};
+
+//-------------------------------------------------------------------------------
+
+//! A point cloud class that uses a k-d tree with quantized point positions.
+//!
+//! Point positions are stored with BITS bits per axis, quantized against the bounding box
+//! of the points, and packed next to the index and splitting plane of each k-d tree node.
+//! For example, with Point3d positions a PointCloud node takes 32 bytes, while a node of this
+//! class takes 12 bytes for both 16 and 21 bits per axis.
+//!
+//! The tree can either return exact results or accept the quantization error.
+//! If a reference point array is set (which is the array given to the Build method,
+//! unless custom indices are used), tree traversal uses conservative bounds on the quantization
+//! error and the final distances are computed exactly using the reference point array.
+//! Otherwise, the dequantized positions are used and the returned distances are approximate.
+
+template <typename PointType, typename FType, uint32_t DIMENSIONS, typename SIZE_TYPE=uint32_t, uint32_t BITS=16>
+class QuantizedPointCloud
+{
+	static_assert( BITS >= 2 && BITS <= 31, "QuantizedPointCloud supports 2 to 31 bits per axis" );
+public:
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Constructors and Destructor
+
+	QuantizedPointCloud() : points(nullptr), pointCount(0), refPoints(nullptr) {}
+	QuantizedPointCloud( SIZE_TYPE numPts, const PointType *pts, const SIZE_TYPE *customIndices=nullptr ) : points(nullptr), pointCount(0), refPoints(nullptr) { Build(numPts,pts,customIndices); }
+	~QuantizedPointCloud() { delete [] points; }
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@ Initialization
+
+	//! Builds a k-d tree for the given points.
+	//! The quantized point locations are stored internally, along with the indices to the given array.
+	//! If no custom indices are given, the given array is kept as the reference point array
+	//! for computing exact distances, so it must NOT be deleted while this class is used.
+	void Build( SIZE_TYPE numPts, const PointType *pts, const SIZE_TYPE *customIndices=nullptr )
+	{
+		if ( points ) delete [] points;
+		pointCount = numPts;
+		refPoints = customIndices ? nullptr : pts;
+		if ( pointCount == 0 ) { points = nullptr; return; }
+		ComputeQuantization( pts );
+		points = new PointData[pointCount+1];
+		SIZE_TYPE *order = new SIZE_TYPE[pointCount];
+		for ( SIZE_TYPE i=0; i<pointCount; i++ ) order[i] = i;
+		BuildKDTree( pts, customIndices, order, 1, 0, pointCount );
+		delete [] order;
+	}
+
+	//! Sets the reference point array that is indexed by the point indices.
+	//! When the reference array is set, the search methods return exact positions and distances.
+	//! Setting it to nullptr makes the search methods use the dequantized positions instead,
+	//! which avoids accessing the reference array, but accepts the quantization error.
+	void SetReferencePoints( const PointType *pts ) { refPoints = pts; }
+
+	//! Returns true if the search methods return exact positions and distances.
+	bool IsExact() const { return refPoints != nullptr; }
+
+	//! Returns the maximum quantization error of a point position along the given axis.
+	FType GetQuantizationError( int axis ) const { return halfCell[axis]; }
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@ General search methods
+
+	//! Returns all points to the given position within the given radius.
+	//! Calls the given pointFound function for each point found.
+	//!
+	//! The given pointFound function can reduce the radiusSquared value.
+	//! However, increasing the radiusSquared value can have unpredictable results.
+	//! The callback function must be in the following form:
+	//!
+	//! void _CALLBACK(SIZE_TYPE index, const PointType &p, FType distanceSquared, FType &radiusSquared)
+	template <typename _CALLBACK>
+	void GetPoints( const PointType &position, FType radius, _CALLBACK pointFound )
+	{
+		if ( pointCount == 0 ) return;
+		SIZE_TYPE internalNodes = (pointCount+1) >> 1;
+		SIZE_TYPE stack[60];	// deep enough for 2^30 points
+		int stackPos = 0;
+		stack[0] = 1;	// root node
+		FType dist2 = radius * radius;
+		FType prune2 = PruneDistanceSquared( dist2 );
+		while ( stackPos >= 0 ) {
+			SIZE_TYPE ix = stack[ stackPos-- ];
+			const PointData *p = &points[ix];
+			if ( ix < internalNodes ) {
+				int axis = p->Plane();
+				FType d = position[axis] - Dequantize( p->Coord(axis), axis );
+				FType dd = cyAbs(d) - ( refPoints ? halfCell[axis] : FType(0) );	// conservative distance to the splitting plane
+				bool visitFar = dd <= FType(0) || dd*dd < dist2;
+				if( d > 0 ) {	// if dist1 is positive search right child first
+					stack[++stackPos] = 2*ix + 1;
+					if ( visitFar ) stack[++stackPos] = 2*ix;
+				} else {	// dist1 is negative, search left child first
+					stack[++stackPos] = 2*ix;
+					if ( visitFar ) stack[++stackPos] = 2*ix + 1;
+				}
+			}
+			TestPoint( p, position, dist2, prune2, pointFound );
+		}
+		if ( (pointCount & SIZE_TYPE(1)) == 0 ) {
+			TestPoint( &points[pointCount], position, dist2, prune2, pointFound );
+		}
+	}
+
+	//! Used by one of the QuantizedPointCloud::GetPoints() methods.
+	//!
+	//! Keeps the point index, position, and distance squared to a given search position.
+	struct PointInfo {
+		SIZE_TYPE index;			//!< The index of the point
+		PointType pos;				//!< The position of the point
+		FType     distanceSquared;	//!< Squared distance from the search position
+		bool operator < (const PointInfo &b) const { return distanceSquared < b.distanceSquared; }	//!< Comparison operator
+	};
+
+	//! Returns the closest points to the given position within the given radius.
+	//! The returned value is the number of points found.
+	int GetPoints( const PointType &position, FType radius, SIZE_TYPE maxCount, PointInfo *closestPoints )
+	{
+		bool tooManyPoints = false;
+		int pointsFound = 0;
+		GetPoints( position, radius, [&](SIZE_TYPE i, const PointType &p, FType d2, FType &r2) {
+			if ( pointsFound == maxCount ) {
+				if ( !tooManyPoints ) {
+					std::make_heap( closestPoints, closestPoints+maxCount );
+					tooManyPoints = true;
+				}
+				std::pop_heap( closestPoints, closestPoints+maxCount );
+				closestPoints[maxCount-1].index = i;
+				closestPoints[maxCount-1].pos = p;
+				closestPoints[maxCount-1].distanceSquared = d2;
+				std::push_heap( closestPoints, closestPoints+maxCount );
+				r2 = closestPoints[0].distanceSquared;
+			} else {
+				closestPoints[pointsFound].index = i;
+				closestPoints[pointsFound].pos = p;
+				closestPoints[pointsFound].distanceSquared = d2;
+				pointsFound++;
+			}
+		} );
+		return pointsFound;
+	}
+
+	//! Returns the closest points to the given position.
+	//! The returned value is the number of points found.
+	int GetPoints( const PointType &position, SIZE_TYPE maxCount, PointInfo *closestPoints )
+	{
+		return GetPoints( position, std::numeric_limits<FType>::max(), maxCount, closestPoints );
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Closest point methods
+
+	//! Returns the closest point to the given position within the given radius.
+	//! The returned value is true, if a point is found.
+	bool GetClosest( const PointType &position, FType radius, SIZE_TYPE &closestIndex, PointType &closestPosition, FType &closestDistanceSquared )
+	{
+		bool found = false;
+		GetPoints( position, radius, [&](SIZE_TYPE i, const PointType &p, FType d2, FType &r2){ found=true; closestIndex=i; closestPosition=p; closestDistanceSquared=d2; r2=d2; } );
+		return found;
+	}
+
+	//! Returns the closest point to the given position.
+	//! The returned value is true, if a point is found.
+	bool GetClosest( const PointType &position, SIZE_TYPE &closestIndex, PointType &closestPosition, FType &closestDistanceSquared )
+	{
+		return GetClosest( position, std::numeric_limits<FType>::max(), closestIndex, closestPosition, closestDistanceSquared );
+	}
+
+	//! Returns the closest point index to the given position.
+	//! The returned value is true, if a point is found.
+	bool GetClosestIndex( const PointType &position, SIZE_TYPE &closestIndex )
+	{
+		FType closestDistanceSquared;
+		PointType closestPosition;
+		return GetClosest( position, closestIndex, closestPosition, closestDistanceSquared );
+	}
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+
+private:
+
+	//////////////////////////////////////////////////////////////////////////!//!//!
+	//!@name Internal Structures and Methods
+
+	class PointData
+	{
+	private:
+		static const uint32_t NWords = ( DIMENSIONS*BITS + 31 ) / 32;
+		SIZE_TYPE indexAndSplitPlane;	// first NBits bits indicates the splitting plane, the rest of the bits store the point index.
+		uint32_t  q[NWords];			// quantized point position, packed with BITS bits per axis
+	public:
+		void Set( const uint32_t *coord, SIZE_TYPE index, uint32_t plane=0 )
+		{
+			indexAndSplitPlane = (index<<NBits()) | (plane&((1<<NBits())-1));
+			for ( uint32_t w=0; w<NWords; w++ ) q[w] = 0;
+			for ( uint32_t d=0; d<DIMENSIONS; d++ ) {
+				uint32_t bit = d*BITS;
+				uint64_t v = uint64_t(coord[d]) << (bit&31);
+				q[bit>>5] |= uint32_t(v);
+				if ( (bit>>5)+1 < NWords ) q[(bit>>5)+1] |= uint32_t(v>>32);
+			}
+		}
+		int       Plane() const { return indexAndSplitPlane & ((1<<NBits())-1); }
+		SIZE_TYPE Index() const { return indexAndSplitPlane >> NBits(); }
+		uint32_t  Coord( int axis ) const
+		{
+			uint32_t bit = axis*BITS;
+			uint32_t w = bit >> 5;
+			uint64_t v = q[w];
+			if ( w+1 < NWords ) v |= uint64_t(q[w+1]) << 32;
+			return uint32_t( v >> (bit&31) ) & ((uint32_t(1)<<BITS)-1);
+		}
+	private:
+		constexpr int NBits(uint32_t v=DIMENSIONS) const { return v < 2 ? v : 1+NBits(v>>1); }
+	};
+
+	PointData       *points;				// Keeps the points as a k-d tree.
+	SIZE_TYPE        pointCount;			// Keeps the point count.
+	const PointType *refPoints;				// The reference point array for exact distance computations (can be null).
+	FType            boundMin[DIMENSIONS];	// Minimum bounds of the points, used for quantization.
+	FType            cellSize[DIMENSIONS];	// Quantization step size along each axis.
+	FType            halfCell[DIMENSIONS];	// Conservative maximum quantization error along each axis.
+	FType            maxError;				// Conservative maximum quantization error of a point position.
+
+	FType    Dequantize( uint32_t c, int axis ) const { return boundMin[axis] + FType(c) * cellSize[axis]; }
+	uint32_t Quantize  ( FType x, int axis ) const
+	{
+		if ( cellSize[axis] <= FType(0) ) return 0;
+		FType c = (x - boundMin[axis]) / cellSize[axis] + FType(0.5);
+		const uint32_t cmax = (uint32_t(1)<<BITS)-1;
+		return c <= FType(0) ? 0 : ( c >= FType(cmax) ? cmax : uint32_t(c) );
+	}
+
+	// Returns the squared distance beyond which the dequantized position cannot be within dist2 of the exact one.
+	FType PruneDistanceSquared( FType dist2 ) const
+	{
+		if ( !refPoints || dist2 >= std::numeric_limits<FType>::max() ) return dist2;
+		FType r = cySqrt(dist2) + maxError;
+		return r*r;
+	}
+
+	// Tests a single point and calls the pointFound function, if the point is within the search radius.
+	template <typename _CALLBACK>
+	void TestPoint( const PointData *p, const PointType &position, FType &dist2, FType &prune2, _CALLBACK &pointFound ) const
+	{
+		PointType pos;
+		for ( uint32_t d=0; d<DIMENSIONS; d++ ) pos[d] = Dequantize( p->Coord(d), d );
+		FType d2 = (pos - position).LengthSquared();
+		if ( refPoints ) {
+			if ( d2 >= prune2 ) return;	// cannot be within the search radius, even with the quantization error
+			const PointType &exact = refPoints[ p->Index() ];
+			d2 = (exact - position).LengthSquared();
+			if ( d2 < dist2 ) {
+				pointFound( p->Index(), exact, d2, dist2 );
+				prune2 = PruneDistanceSquared( dist2 );
+			}
+		} else {
+			if ( d2 < dist2 ) pointFound( p->Index(), pos, d2, dist2 );
+		}
+	}
+
+	// Computes the quantization grid using the bounding box of the given points.
+	void ComputeQuantization( const PointType *pts )
+	{
+		FType boundMax[DIMENSIONS];
+		for ( uint32_t d=0; d<DIMENSIONS; d++ ) boundMin[d] = boundMax[d] = pts[0][d];
+		for ( SIZE_TYPE i=1; i<pointCount; i++ ) {
+			for ( uint32_t d=0; d<DIMENSIONS; d++ ) {
+				if ( boundMin[d] > pts[i][d] ) boundMin[d] = pts[i][d];
+				if ( boundMax[d] < pts[i][d] ) boundMax[d] = pts[i][d];
+			}
+		}
+		FType err2 = FType(0);
+		for ( uint32_t d=0; d<DIMENSIONS; d++ ) {
+			cellSize[d] = ( boundMax[d] - boundMin[d] ) / FType( (uint32_t(1)<<BITS)-1 );
+			// Half of the step size, slightly enlarged to account for floating point rounding
+			halfCell[d] = cellSize[d] * FType(0.5) * FType(1.001) + ( cyAbs(boundMin[d]) + cyAbs(boundMax[d]) ) * std::numeric_limits<FType>::epsilon();
+			err2 += halfCell[d] * halfCell[d];
+		}
+		maxError = cySqrt(err2);
+	}
+
+	// The main method for recursively building the k-d tree.
+	void BuildKDTree( const PointType *pts, const SIZE_TYPE *indices, SIZE_TYPE *order, SIZE_TYPE kdIndex, SIZE_TYPE ixStart, SIZE_TYPE ixEnd )
+	{
+		SIZE_TYPE n = ixEnd - ixStart;
+		if ( n <= 1 ) {
+			if ( n > 0 ) {
+				SIZE_TYPE ix = order[ixStart];
+				SetPoint( kdIndex, pts[ix], indices ? indices[ix] : ix, 0 );
+			}
+		} else {
+			int axis = SplitAxis( pts, order, ixStart, ixEnd );
+			SIZE_TYPE leftSize = LeftSize(n);
+			SIZE_TYPE ixMid = ixStart+leftSize;
+			std::nth_element( order+ixStart, order+ixMid, order+ixEnd, [&pts,axis](const SIZE_TYPE &a, const SIZE_TYPE &b){ return pts[a][axis] < pts[b][axis]; } );
+			SIZE_TYPE ix = order[ixMid];
+			SetPoint( kdIndex, pts[ix], indices ? indices[ix] : ix, axis );
+			BuildKDTree( pts, indices, order, kdIndex*2,   ixStart, ixMid );
+			BuildKDTree( pts, indices, order, kdIndex*2+1, ixMid+1, ixEnd );
+		}
+	}
+
+	// Quantizes the given point and stores it at the given k-d tree node.
+	void SetPoint( SIZE_TYPE kdIndex, const PointType &p, SIZE_TYPE index, uint32_t plane )
+	{
+		uint32_t coord[DIMENSIONS];
+		for ( uint32_t d=0; d<DIMENSIONS; d++ ) coord[d] = Quantize( p[d], d );
+		points[kdIndex].Set( coord, index, plane );
+	}
+
+	// Returns the total number of nodes on the left sub-tree of a complete k-d tree of size n.
+	SIZE_TYPE LeftSize( SIZE_TYPE n )
+	{
+		SIZE_TYPE f = n; // Size of the full tree
+		for ( SIZE_TYPE s=1; s<8*sizeof(SIZE_TYPE); s*=2 ) f |= f >> s;
+		SIZE_TYPE l = f >> 1; // Size of the full left child
+		SIZE_TYPE r = l >> 1; // Size of the full right child without leaf nodes
+		return (l+r+1 <= n) ? l : n-r-1;
+	}
+
+	// Returns axis with the largest span, used as the splitting axis for building the k-d tree
+	int SplitAxis( const PointType *pts, SIZE_TYPE *indices, SIZE_TYPE ixStart, SIZE_TYPE ixEnd )
+	{
+		PointType box_min = pts[ indices[ixStart] ];
+		PointType box_max = box_min;
+		for ( SIZE_TYPE i=ixStart+1; i<ixEnd; i++ ) {
+			PointType p = pts[ indices[i] ];
+			for ( SIZE_TYPE d=0; d<DIMENSIONS; d++ ) {
+				if ( box_min[d] > p[d] ) box_min[d] = p[d];
+				if ( box_max[d] < p[d] ) box_max[d] = p[d];
+			}
+		}
+		int axis = 0;
+		{
+			FType axisSize = box_max[0] - box_min[0];
+			for ( SIZE_TYPE d=1; d<DIMENSIONS; d++ ) {
+				FType s = box_max[d] - box_min[d];
+				if ( axisSize < s ) {
+					axis = d;
+					axisSize = s;
+				}
+			}
+		}
+		return axis;
+	}
+
 	//////////////////////////////////////////////////////////////////////////!//!//!
 };
 
@@ -389,6 +799,13 @@ template <uint32_t DIMENSIONS> using PointCloudNi  = PointCloudN<int32_t, DIMENS
 template <uint32_t DIMENSIONS> using PointCloudNui = PointCloudN<uint32_t,DIMENSIONS>;	//!< A multi-dimensional point cloud using a k-d tree with 32-bit unsigned integer (uint32_t)
 template <uint64_t DIMENSIONS> using PointCloudNl  = PointCloudN<int64_t, DIMENSIONS>;	//!< A multi-dimensional point cloud using a k-d tree with 64-bit signed integer (int64_t)
 template <uint64_t DIMENSIONS> using PointCloudNul = PointCloudN<uint64_t,DIMENSIONS>;	//!< A multi-dimensional point cloud using a k-d tree with 64-bit unsigned integer (uint64_t)
+
+typedef QuantizedPointCloud<Point2f,float,2>  QuantizedPointCloud2f;	//!< A 2D point cloud using a k-d tree with 16-bit quantized positions and single precision (float)
+typedef QuantizedPointCloud<Point3f,float,3>  QuantizedPointCloud3f;	//!< A 3D point cloud using a k-d tree with 16-bit quantized positions and single precision (float)
+typedef QuantizedPointCloud<Point2d,double,2> QuantizedPointCloud2d;	//!< A 2D point cloud using a k-d tree with 16-bit quantized positions and double precision (double)
+typedef QuantizedPointCloud<Point3d,double,3> QuantizedPointCloud3d;	//!< A 3D point cloud using a k-d tree with 16-bit quantized positions and double precision (double)
+
+template <typename TYPE, uint32_t DIMENSIONS, uint32_t BITS=16> using QuantizedPointCloudN = QuantizedPointCloud<Point<TYPE,DIMENSIONS>,TYPE,DIMENSIONS,uint32_t,BITS>;	//!< A multi-dimensional point cloud using a k-d tree with quantized positions
 #endif
 
 //-------------------------------------------------------------------------------
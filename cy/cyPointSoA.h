@@ -0,0 +1,352 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyPointSoA.h
+//! \author Cem Yuksel
+//!
+//! \brief  Structure-of-arrays storage for 3D points.
+//!
+//! This file includes a class that keeps the x, y, and z coordinates of points
+//! in separate aligned arrays, so that the loops over the points can be
+//! vectorized without gathering the coordinates. It also includes vectorized
+//! kernels for bounding boxes, transformations, and vertex normals.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_POINT_SOA_H_INCLUDED_
+#define _CY_POINT_SOA_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_SOA_ALIGNMENT
+#define _CY_SOA_ALIGNMENT 64	// the alignment of the arrays in bytes, which is the width of AVX-512 registers
+#endif
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyPoint.h"
+#include "cyMatrix.h"
+#include <stdint.h>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Structure-of-arrays storage for 3D points.
+//!
+//! The x, y, and z coordinates are kept in separate arrays that are aligned to _CY_SOA_ALIGNMENT
+//! bytes. Each array is padded to a multiple of BLOCK_SIZE elements and the padding elements are
+//! zero, so SIMD code can process the arrays in whole blocks. The points can be accessed like an
+//! array of Point3 through the Reference view type.
+
+template <typename TYPE>
+class Point3SoA
+{
+public:
+	//! The number of elements in an aligned block
+	static const size_t BLOCK_SIZE = _CY_SOA_ALIGNMENT / sizeof(TYPE);
+
+	//! A view of a point that refers to its coordinates in the three arrays.
+	//! It can be used like a reference to a Point3 for reading and writing the point.
+	class Reference
+	{
+	public:
+		TYPE &x, &y, &z;
+		Reference( TYPE &_x, TYPE &_y, TYPE &_z ) : x(_x), y(_y), z(_z) {}
+		operator Point3<TYPE>() const { return Point3<TYPE>(x,y,z); }
+		TYPE& operator [] ( int i ) const { return i == 0 ? x : ( i == 1 ? y : z ); }
+		Reference& operator =  ( const Reference    &r ) { return operator = ( Point3<TYPE>(r) ); }
+		Reference& operator =  ( const Point3<TYPE> &p ) { x =p.x; y =p.y; z =p.z; return *this; }
+		Reference& operator += ( const Point3<TYPE> &p ) { x+=p.x; y+=p.y; z+=p.z; return *this; }
+		Reference& operator -= ( const Point3<TYPE> &p ) { x-=p.x; y-=p.y; z-=p.z; return *this; }
+		Reference& operator *= ( TYPE s ) { x*=s; y*=s; z*=s; return *this; }
+	};
+
+	//!@name Constructors and destructor
+	Point3SoA() : buffer(NULL), data(NULL), count(0), capacity(0) {}
+	explicit Point3SoA( size_t n ) : buffer(NULL), data(NULL), count(0), capacity(0) { Resize(n); }
+	Point3SoA( const Point3<TYPE> *points, size_t n ) : buffer(NULL), data(NULL), count(0), capacity(0) { Set(points,n); }
+	~Point3SoA() { delete [] buffer; }
+
+	//!@name Access methods
+	size_t       Size      () const { return count; }						//!< Returns the number of points.
+	size_t       PaddedSize() const { return capacity; }					//!< Returns the number of elements in each array, including the padding.
+	TYPE*        X() { return data; }										//!< Returns the array of x coordinates.
+	TYPE*        Y() { return data + capacity; }							//!< Returns the array of y coordinates.
+	TYPE*        Z() { return data + 2*capacity; }							//!< Returns the array of z coordinates.
+	const TYPE*  X() const { return data; }								//!< Returns the array of x coordinates.
+	const TYPE*  Y() const { return data + capacity; }						//!< Returns the array of y coordinates.
+	const TYPE*  Z() const { return data + 2*capacity; }					//!< Returns the array of z coordinates.
+	Reference    operator [] ( size_t i )       { return Reference( X()[i], Y()[i], Z()[i] ); }		//!< Returns a view of the i^th point.
+	Point3<TYPE> operator [] ( size_t i ) const { return Point3<TYPE>( X()[i], Y()[i], Z()[i] ); }	//!< Returns the i^th point.
+
+	//!@name Set and get methods
+
+	//! Sets the number of points. The existing points are kept and the new points are set to zero.
+	void Resize( size_t n );
+
+	//! Sets the points by copying them from the given array.
+	void Set( const Point3<TYPE> *points, size_t n );
+
+	//! Copies the points to the given array, which must have at least Size() elements.
+	void Get( Point3<TYPE> *points ) const;
+
+	//!@name Vectorized kernels
+
+	//! Computes the bounding box of the points. Returns false if there are no points.
+	bool ComputeBounds( Point3<TYPE> &boundMin, Point3<TYPE> &boundMax ) const;
+
+	//! Transforms the points using the given matrix.
+	void Transform( const Matrix34<TYPE> &m );
+
+	//! Transforms the points using the given matrix.
+	void Transform( const Matrix3<TYPE> &m );
+
+	//! Normalizes the points as vectors. Vectors with zero length remain zero.
+	void Normalize();
+
+	//! Sets the points as the vertex normals of the given triangles, which are computed by adding the
+	//! (not normalized) face normals in face order and normalizing the sums. Therefore, the face normals
+	//! are weighted by the face areas. The faces array contains three vertex indices for each face.
+	//! The cross products of the faces are vectorized in blocks, but the vertices are gathered by index
+	//! from three arrays, so this is not faster than computing the normals of the same points in an
+	//! array of Point3. It avoids converting the points that are already kept in this storage.
+	void ComputeVertexNormals( const Point3SoA &verts, const unsigned int *faces, size_t faceCount, bool clockwise=false );
+
+private:
+	char  *buffer;		// the allocated memory
+	TYPE  *data;		// the aligned x, y, and z arrays, one after the other
+	size_t count;		// the number of points
+	size_t capacity;	// the padded size of each array
+
+	Point3SoA( const Point3SoA& );					// not copyable
+	Point3SoA& operator = ( const Point3SoA& );		// not copyable
+};
+
+//-------------------------------------------------------------------------------
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Resize( size_t n )
+{
+	size_t newCapacity = ( n + BLOCK_SIZE - 1 ) / BLOCK_SIZE * BLOCK_SIZE;
+	if ( newCapacity != capacity ) {
+		char *newBuffer = newCapacity > 0 ? new char[ newCapacity*3*sizeof(TYPE) + _CY_SOA_ALIGNMENT ] : NULL;
+		TYPE *newData = newBuffer ? (TYPE*)( ( uintptr_t(newBuffer) + _CY_SOA_ALIGNMENT - 1 ) & ~uintptr_t(_CY_SOA_ALIGNMENT - 1) ) : NULL;
+		size_t keep = count < n ? count : n;
+		for ( int a=0; a<3; a++ ) {
+			TYPE *dst = newData + a*newCapacity;
+			if ( keep > 0 ) memcpy( dst, data + a*capacity, keep*sizeof(TYPE) );
+			for ( size_t i=keep; i<newCapacity; i++ ) dst[i] = TYPE(0);
+		}
+		delete [] buffer;
+		buffer   = newBuffer;
+		data     = newData;
+		capacity = newCapacity;
+	} else {
+		// Clear the removed points or the new points
+		size_t first = count < n ? count : n;
+		size_t last  = count < n ? n : count;
+		for ( int a=0; a<3; a++ ) for ( size_t i=first; i<last; i++ ) data[ a*capacity + i ] = TYPE(0);
+	}
+	count = n;
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Set( const Point3<TYPE> *points, size_t n )
+{
+	Resize( n );
+	TYPE *x = X(), *y = Y(), *z = Z();
+	ParallelForRanges( size_t(0), n, ParallelRangeCount(n), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		for ( size_t i=rangeBegin; i<rangeEnd; i++ ) { x[i] = points[i].x; y[i] = points[i].y; z[i] = points[i].z; }
+	} );
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Get( Point3<TYPE> *points ) const
+{
+	const TYPE *x = X(), *y = Y(), *z = Z();
+	ParallelForRanges( size_t(0), count, ParallelRangeCount(count), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		for ( size_t i=rangeBegin; i<rangeEnd; i++ ) points[i].Set( x[i], y[i], z[i] );
+	} );
+}
+
+template <typename TYPE>
+inline bool Point3SoA<TYPE>::ComputeBounds( Point3<TYPE> &boundMin, Point3<TYPE> &boundMax ) const
+{
+	if ( count == 0 ) return false;
+	// Each range keeps the minimum and maximum of each lane of the blocks, so the inner loop
+	// has no dependencies between the lanes. The remaining points are handled by the last range.
+	const size_t blockCount = count / BLOCK_SIZE;
+	const int rangeCount = ParallelRangeCount( count );
+	std::vector<TYPE> rangeMin( size_t(rangeCount)*3 ), rangeMax( size_t(rangeCount)*3 );
+	ParallelForRanges( size_t(0), blockCount > 0 ? blockCount : 1, rangeCount, [&]( int r, size_t blockBegin, size_t blockEnd ) {
+		for ( int a=0; a<3; a++ ) {
+			const TYPE *p = data + a*capacity;
+			TYPE lmin[BLOCK_SIZE], lmax[BLOCK_SIZE];
+			for ( size_t j=0; j<BLOCK_SIZE; j++ ) lmin[j] = lmax[j] = p[ blockBegin*BLOCK_SIZE ];
+			for ( size_t b=blockBegin; b<blockEnd && b<blockCount; b++ ) {
+				const TYPE *block = p + b*BLOCK_SIZE;
+				_CY_IVDEP_FOR ( size_t j=0; j<BLOCK_SIZE; j++ ) {
+					lmin[j] = block[j] < lmin[j] ? block[j] : lmin[j];
+					lmax[j] = block[j] > lmax[j] ? block[j] : lmax[j];
+				}
+			}
+			TYPE pmin = lmin[0], pmax = lmax[0];
+			for ( size_t j=1; j<BLOCK_SIZE; j++ ) {
+				if ( pmin > lmin[j] ) pmin = lmin[j];
+				if ( pmax < lmax[j] ) pmax = lmax[j];
+			}
+			if ( blockEnd >= blockCount ) {
+				for ( size_t i=blockCount*BLOCK_SIZE; i<count; i++ ) {
+					if ( pmin > p[i] ) pmin = p[i];
+					if ( pmax < p[i] ) pmax = p[i];
+				}
+			}
+			rangeMin[ r*3 + a ] = pmin;
+			rangeMax[ r*3 + a ] = pmax;
+		}
+	} );
+	const int usedRanges = blockCount > size_t(rangeCount) ? rangeCount : ( blockCount > 0 ? int(blockCount) : 1 );
+	for ( int a=0; a<3; a++ ) {
+		boundMin[a] = rangeMin[a];
+		boundMax[a] = rangeMax[a];
+		for ( int r=1; r<usedRanges; r++ ) {
+			if ( boundMin[a] > rangeMin[ r*3 + a ] ) boundMin[a] = rangeMin[ r*3 + a ];
+			if ( boundMax[a] < rangeMax[ r*3 + a ] ) boundMax[a] = rangeMax[ r*3 + a ];
+		}
+	}
+	return true;
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Transform( const Matrix34<TYPE> &m )
+{
+	TYPE *x = X(), *y = Y(), *z = Z();
+	const TYPE *d = m.data;
+	ParallelForRanges( size_t(0), count, ParallelRangeCount(count), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		_CY_IVDEP_FOR ( size_t i=rangeBegin; i<rangeEnd; i++ ) {
+			TYPE px = x[i], py = y[i], pz = z[i];
+			x[i] = d[0]*px + d[3]*py + d[6]*pz + d[ 9];
+			y[i] = d[1]*px + d[4]*py + d[7]*pz + d[10];
+			z[i] = d[2]*px + d[5]*py + d[8]*pz + d[11];
+		}
+	} );
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Transform( const Matrix3<TYPE> &m )
+{
+	TYPE *x = X(), *y = Y(), *z = Z();
+	const TYPE *d = m.data;
+	ParallelForRanges( size_t(0), count, ParallelRangeCount(count), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		_CY_IVDEP_FOR ( size_t i=rangeBegin; i<rangeEnd; i++ ) {
+			TYPE px = x[i], py = y[i], pz = z[i];
+			x[i] = d[0]*px + d[3]*py + d[6]*pz;
+			y[i] = d[1]*px + d[4]*py + d[7]*pz;
+			z[i] = d[2]*px + d[5]*py + d[8]*pz;
+		}
+	} );
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::Normalize()
+{
+	TYPE *x = X(), *y = Y(), *z = Z();
+	ParallelForRanges( size_t(0), count, ParallelRangeCount(count), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		_CY_IVDEP_FOR ( size_t i=rangeBegin; i<rangeEnd; i++ ) {
+			TYPE len2 = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+			TYPE s = len2 > TYPE(0) ? TYPE(1) / cySqrt(len2) : TYPE(0);
+			x[i] *= s;
+			y[i] *= s;
+			z[i] *= s;
+		}
+	} );
+}
+
+template <typename TYPE>
+inline void Point3SoA<TYPE>::ComputeVertexNormals( const Point3SoA &verts, const unsigned int *faces, size_t faceCount, bool clockwise )
+{
+	Resize( 0 );
+	Resize( verts.Size() );
+	if ( faceCount == 0 ) return;
+
+	// The face normals are computed in blocks. The edge vectors of the faces in a block are gathered
+	// into separate arrays, so that the cross products are vectorized. The face normals are added
+	// to the vertices in face order, so the sums are the same as the ones of TriMesh::ComputeNormals.
+	// The sums are kept interleaved, so that adding a face normal to a vertex accesses a single cache line.
+	const size_t FACE_BLOCK = 256;
+	const size_t vertexCount = verts.Size();
+	std::vector<TYPE> sums( vertexCount*3, TYPE(0) );
+	const TYPE *vx = verts.X(), *vy = verts.Y(), *vz = verts.Z();
+	TYPE e1x[FACE_BLOCK], e1y[FACE_BLOCK], e1z[FACE_BLOCK], e2x[FACE_BLOCK], e2y[FACE_BLOCK], e2z[FACE_BLOCK];
+	TYPE nx[FACE_BLOCK], ny[FACE_BLOCK], nz[FACE_BLOCK];
+	for ( size_t first=0; first<faceCount; first+=FACE_BLOCK ) {
+		const size_t n = faceCount - first < FACE_BLOCK ? faceCount - first : FACE_BLOCK;
+		const unsigned int *f = faces + first*3;
+		for ( size_t k=0; k<n; k++ ) {
+			unsigned int i0 = f[k*3], i1 = f[k*3+1], i2 = f[k*3+2];
+			if ( clockwise ) { unsigned int t = i1; i1 = i2; i2 = t; }	// flips the face normal
+			e1x[k] = vx[i1] - vx[i0];  e1y[k] = vy[i1] - vy[i0];  e1z[k] = vz[i1] - vz[i0];
+			e2x[k] = vx[i2] - vx[i0];  e2y[k] = vy[i2] - vy[i0];  e2z[k] = vz[i2] - vz[i0];
+		}
+		_CY_IVDEP_FOR ( size_t k=0; k<n; k++ ) {
+			nx[k] = e1y[k]*e2z[k] - e1z[k]*e2y[k];
+			ny[k] = e1z[k]*e2x[k] - e1x[k]*e2z[k];
+			nz[k] = e1x[k]*e2y[k] - e1y[k]*e2x[k];
+		}
+		for ( size_t k=0; k<n; k++ ) {
+			for ( int j=0; j<3; j++ ) {
+				TYPE *sum = sums.data() + size_t(f[k*3+j])*3;
+				sum[0] += nx[k];
+				sum[1] += ny[k];
+				sum[2] += nz[k];
+			}
+		}
+	}
+	TYPE *x = X(), *y = Y(), *z = Z();
+	ParallelForRanges( size_t(0), vertexCount, ParallelRangeCount(vertexCount), [&]( int, size_t rangeBegin, size_t rangeEnd ) {
+		for ( size_t i=rangeBegin; i<rangeEnd; i++ ) { x[i] = sums[i*3]; y[i] = sums[i*3+1]; z[i] = sums[i*3+2]; }
+	} );
+	Normalize();
+}
+
+//-------------------------------------------------------------------------------
+
+typedef Point3SoA<float>  Point3fSoA;	//!< Structure-of-arrays storage for single precision (float) 3D points
+typedef Point3SoA<double> Point3dSoA;	//!< Structure-of-arrays storage for double precision (double) 3D points
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::Point3fSoA cyPoint3fSoA;	//!< Structure-of-arrays storage for single precision (float) 3D points
+typedef cy::Point3dSoA cyPoint3dSoA;	//!< Structure-of-arrays storage for double precision (double) 3D points
+
+//-------------------------------------------------------------------------------
+
+#endif
@@ -63,6 +63,7 @@
 #include "cyCore.h"
 #include "cyHeap.h"
 #include "cyPointCloud.h"
+#include <vector>
 
 //-------------------------------------------------------------------------------
 namespace cy {
@@ -93,6 +94,8 @@ public:
 		gamma = FType(1.5);
 		tiling = false;
 		weightLimiting = true;
+		neighborCaching = false;
+		partitionCount = 1;
 	}
 
 	//! Tiling determines whether the generated samples are tile-able. 
@@ -114,6 +117,33 @@ public:
 	//! Returns true if weight limiting is turned on.
 	bool IsWeightLimiting() const { return weightLimiting; }
 
+	//! Neighbor caching computes the neighbors of all samples within d_max radius only once,
+	//! in parallel, and keeps them in a compact neighbor list along with their weights.
+	//! Elimination then walks over the cached lists, instead of querying the k-d tree again
+	//! for each eliminated sample. This is typically several times faster, but the memory
+	//! needed for the neighbor lists grows with the average number of neighbors per sample.
+	//! Since the initial weights are computed using multiple threads, the weight function must be
+	//! thread-safe when neighbor caching is on. Neighbor caching is off by default.
+	void SetNeighborCaching( bool on=true ) { neighborCaching = on; }
+
+	//! Returns true if neighbor caching is turned on.
+	bool IsNeighborCaching() const { return neighborCaching; }
+
+	//! Sets the number of partitions used for parallel elimination. If the count is greater than one,
+	//! the sampling domain is split into the given number of slabs along its longest axis.
+	//! Each slab, along with the samples within 2*d_max of it, is processed independently in parallel,
+	//! targeting an output size proportional to its sample count. Then, a serial pass repeats the
+	//! elimination for the input samples within d_max of the slab boundaries, keeping the other
+	//! selected samples fixed. The results are close to, but not the same as, the results of serial
+	//! elimination. The number of partitions is reduced, if necessary, to keep the slabs at least
+	//! 2*d_max wide. Progressive sampling only uses the partitions for the first round. A good
+	//! choice is a small multiple of the number of threads. Since the slabs are processed using multiple
+	//! threads, the weight function must be thread-safe. The default partition count is one.
+	void SetPartitionCount( int count ) { partitionCount = count > 1 ? count : 1; }
+
+	//! Returns the number of partitions used for parallel elimination.
+	int GetPartitionCount() const { return partitionCount; }
+
 	//! Returns the minimum bounds of the sampling domain.
 	//! The sampling domain boundaries are used for tiling and computing the maximum possible
 	//! Poisson disk radius for the sampling domain. The default boundaries are between 0 and 1.
@@ -182,6 +212,8 @@ public:
 	//! between these two points, and d_max is the current radius for the weight function.
 	//! Note that if the progressive parameter is on, the d_max value sent to the weight function can be
 	//! different than the d_max value passed to this method.
+	//! The weight function is called from multiple threads only if neighbor caching is on or the partition
+	//! count is greater than one (see SetNeighborCaching and SetPartitionCount).
 	template <typename WeightFunction>
 	void Eliminate ( 
 		const PointType *inputPoints, 
@@ -197,23 +229,9 @@ public:
 		assert( outputSize < inputSize );
 		assert( dimensions <= DIMENSIONS && dimensions >= 2 );
 		if ( d_max <= FType(0) ) d_max = 2 * GetMaxPoissonDiskRadius( dimensions, outputSize );
-		DoEliminate( inputPoints, inputSize, outputPoints, outputSize, d_max, weightFunction, false );
-		if ( progressive ) {
-			std::vector<PointType> tmpPoints( outputSize );
-			PointType *inPts  = outputPoints;
-			PointType *outPts = tmpPoints.data();
-			SIZE_TYPE inSize  = outputSize;
-			SIZE_TYPE outSize = 0;
-			while ( inSize >= 3 ) {
-				outSize = inSize / 2;
-				d_max *= ProgressiveRadiusMultiplier( dimensions );
-				DoEliminate( inPts, inSize, outPts, outSize, d_max, weightFunction, true );
-				if ( outPts != outputPoints ) CY_MEMCOPY( PointType, outputPoints+outSize, outPts+outSize, inSize-outSize );
-				PointType *tmpPts = inPts; inPts = outPts; outPts = tmpPts;
-				inSize = outSize;
-			}
-			if ( inPts != outputPoints ) CY_MEMCOPY( PointType, outputPoints, inPts, outSize );
-		}
+		if ( partitionCount > 1 ) DoEliminateParallel( inputPoints, inputSize, outputPoints, outputSize, d_max, weightFunction );
+		else DoEliminate( inputPoints, inputSize, outputPoints, outputSize, d_max, weightFunction, false );
+		if ( progressive ) DoEliminateProgressive( outputPoints, outputSize, d_max, dimensions, weightFunction );
 	}
 
 	//! This is the main method that uses weighted sample elimination for selecting a subset of samples
@@ -266,6 +284,64 @@ public:
 		}
 	}
 
+	//! This method uses weighted sample elimination with a spatially varying radius for selecting a subset
+	//! of samples with adaptive blue noise characteristics from a given input sample set (inputPoints).
+	//! The selected samples are copied to outputPoints. The output size must be smaller than the input size.
+	//!
+	//! The radius array provides the d_max value of each input sample. The weight of a sample is computed
+	//! using its own d_max value and the neighbors within it, so the k-d tree is queried with the radius of each
+	//! sample, instead of the largest radius. The output density follows the radius, such that regions with
+	//! a smaller radius receive more samples. For an importance (density) function in N dimensions, the radius
+	//! should be proportional to the inverse of the N-th root of the density.
+	//!
+	//! The neighbors of all samples are always cached (see SetNeighborCaching). Since a sample can be
+	//! a neighbor of another sample with a larger radius without being within its own radius, the cached
+	//! lists are reversed before elimination, so that eliminating a sample updates the weights of all samples
+	//! that it contributes to. The neighbors are found using multiple threads only if neighbor caching is on.
+	//! Progressive sampling and partitions are not used by this method.
+	//!
+	//! The weight function has the same form as the one used by the Eliminate method, and the d_max
+	//! value sent to it is the radius of the sample p0, whose weight is computed.
+	template <typename WeightFunction>
+	void EliminateAdaptive (
+		const PointType *inputPoints,
+		SIZE_TYPE        inputSize,
+		PointType       *outputPoints,
+		SIZE_TYPE        outputSize,
+		const FType     *radius,
+		WeightFunction   weightFunction
+		) const
+	{
+		assert( outputSize < inputSize );
+		DoEliminateAdaptive( inputPoints, inputSize, outputPoints, outputSize, radius, weightFunction );
+	}
+
+	//! This method uses weighted sample elimination with a spatially varying radius for selecting a subset
+	//! of samples with adaptive blue noise characteristics from a given input sample set (inputPoints).
+	//! The selected samples are copied to outputPoints. The output size must be smaller than the input size.
+	//! This method uses the default weight function with the radius of each sample as its d_max value.
+	//! The radius array provides the d_max value of each input sample.
+	void EliminateAdaptive (
+		const PointType *inputPoints,
+		SIZE_TYPE        inputSize,
+		PointType       *outputPoints,
+		SIZE_TYPE        outputSize,
+		const FType     *radius
+		) const
+	{
+		FType alpha = this->alpha;
+		FType fraction = weightLimiting ? GetWeightLimitFraction( inputSize, outputSize ) : FType(0);
+		EliminateAdaptive( inputPoints, inputSize, outputPoints, outputSize, radius,
+			[fraction, alpha] (const PointType &, const PointType &, FType d2, FType d_max)
+			{
+				FType d = cySqrt(d2);
+				FType d_min = d_max * fraction;
+				if ( d < d_min ) d = d_min;
+				return cyPow( FType(1) - d/d_max, alpha );
+			}
+		);
+	}
+
 	//! Returns the maximum possible Poisson disk radius in the given dimensions for the given sampleCount
 	//! to spread over the given domainSize. If the domainSize argument is zero or negative, it is computed
 	//! as the area or N-dimensional volume of the box defined by the minimum and maximum bounds.
@@ -301,28 +377,26 @@ private:
 	FType     alpha, beta, gamma;	// Parameters of the default weight function.
 	bool      weightLimiting;		// Specifies whether weight limiting is used with the default weight function.
 	bool      tiling;				// Specifies whether the sampling domain is tiled.
+	bool      neighborCaching;		// Specifies whether the neighbors of all samples are cached before elimination.
+	int       partitionCount;		// The number of partitions for parallel elimination.
 
-	// Reflects a point near the bounds of the sampling domain off of all domain bounds for tiling.
-	template <typename OPERATION>
-	void TilePoint( SIZE_TYPE index, const PointType &point, FType d_max, OPERATION operation, int dim=0 ) const
+	// Finds the samples within d_max of the given point. When tiling, the distances are computed
+	// periodically in the sampling domain, except along openAxis, unless it is negative.
+	template <typename KDTree, typename _CALLBACK>
+	void GetNeighbors( KDTree &kdtree, const PointType &point, FType d_max, _CALLBACK pointFound, int openAxis=-1 ) const
 	{
-		for ( int d=dim; d<DIMENSIONS; d++ ) {
-			if ( boundsMax[d] - point[d] < d_max ) {
-				PointType p = point;
-				p[d] -= boundsMax[d] - boundsMin[d];
-				operation( index, p );
-				TilePoint( index, p, d_max, operation, d+1 );
-			}
-			if ( point[d] - boundsMin[d] < d_max ) {
-				PointType p = point;
-				p[d] += boundsMax[d] - boundsMin[d];
-				operation( index, p );
-				TilePoint( index, p, d_max, operation, d+1 );
-			}
+		if ( tiling ) {
+			PointType periodMax = boundsMax;
+			if ( openAxis >= 0 ) periodMax[openAxis] = boundsMin[openAxis];
+			kdtree.GetPointsPeriodic( point, d_max, boundsMin, periodMax, pointFound );
+		} else {
+			kdtree.GetPoints( point, d_max, pointFound );
 		}
 	}
 
 	// This is the method that performs weighted sample elimination.
+	// If outputIndices is not null, the indices of the output samples are also stored.
+	// When tiling, the sampling domain is not tiled along openAxis, unless it is negative.
 	template <typename WeightFunction>
 	void DoEliminate( 
 		const PointType *inputPoints, 
@@ -331,34 +405,33 @@ private:
 		SIZE_TYPE        outputSize, 
 		FType            d_max,
 		WeightFunction   weightFunction,
-		bool             copyEliminated
+		bool             copyEliminated,
+		SIZE_TYPE       *outputIndices = nullptr,
+		int              openAxis = -1
 		) const
 	{
 		// Build a k-d tree for samples
 		PointCloud<PointType,FType,DIMENSIONS,SIZE_TYPE> kdtree;
-		if ( tiling ) {
-			std::vector<PointType> point(inputPoints, inputPoints + inputSize);
-			std::vector<SIZE_TYPE> index(inputSize);
-			for ( SIZE_TYPE i=0; i<inputSize; i++ ) index[i] = i;
-			auto AppendPoint = [&]( SIZE_TYPE ix, const PointType &pt ) {
-				point.push_back(pt);
-				index.push_back(ix);
-			};
-			for ( SIZE_TYPE i=0; i<inputSize; i++ ) TilePoint( i, inputPoints[i], d_max, AppendPoint );
-			kdtree.Build( point.size(), point.data(), index.data() );
-		} else {
-			kdtree.Build( inputSize, inputPoints );
-		}
+		kdtree.Build( inputSize, inputPoints );
 
 		// Assign weights to each sample
 		std::vector<FType> w( inputSize, FType(0) );
-		auto AddWeights = [&]( SIZE_TYPE index, const PointType &point ) {
-			kdtree.GetPoints( point, d_max, [&weightFunction,d_max,&w,index,&point,&inputSize]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
-				if ( i >= inputSize ) return;
-				if ( i != index ) w[index] += weightFunction(point,p,d2,d_max);
+		NeighborLists neighbors;
+		if ( neighborCaching ) {
+			CacheNeighbors( kdtree, inputPoints, inputSize, d_max, weightFunction, neighbors, openAxis );
+			ParallelFor( SIZE_TYPE(0), inputSize, [&w,&neighbors]( SIZE_TYPE i ) {
+				FType sum = FType(0);
+				for ( SIZE_TYPE j=neighbors.start[i]; j<neighbors.start[i+1]; j++ ) sum += neighbors.weight[j];
+				w[i] = sum;
 			} );
-		};
-		for ( SIZE_TYPE i=0; i<inputSize; i++ ) AddWeights( i, inputPoints[i] );
+		} else {
+			auto AddWeights = [&]( SIZE_TYPE index, const PointType &point ) {
+				GetNeighbors( kdtree, point, d_max, [&weightFunction,d_max,&w,index,&point]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+					if ( i != index ) w[index] += weightFunction(point,p,d2,d_max);
+				}, openAxis );
+			};
+			for ( SIZE_TYPE i=0; i<inputSize; i++ ) AddWeights( i, inputPoints[i] );
+		}
 
 		// Build a heap for the samples using their weights
 		Heap<FType,SIZE_TYPE> heap;
@@ -367,13 +440,20 @@ private:
 
 		// While the number of samples is greater than desired
 		auto RemoveWeights = [&]( SIZE_TYPE index, const PointType &point ) {
-			kdtree.GetPoints( point, d_max, [&weightFunction,d_max,&w,index,&point,&heap,&inputSize]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
-				if ( i >= inputSize ) return;
+			if ( neighborCaching ) {
+				for ( SIZE_TYPE j=neighbors.start[index]; j<neighbors.start[index+1]; j++ ) {
+					SIZE_TYPE i = neighbors.index[j];
+					w[i] -= neighbors.weight[j];
+					heap.MoveItemDown(i);
+				}
+				return;
+			}
+			GetNeighbors( kdtree, point, d_max, [&weightFunction,d_max,&w,index,&point,&heap]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
 				if ( i != index ) {
 					w[i] -= weightFunction(point,p,d2,d_max);
 					heap.MoveItemDown(i);
 				}
-			} );
+			}, openAxis );
 		};
 		SIZE_TYPE sampleSize = inputSize;
 		while ( sampleSize > outputSize ) {
@@ -388,8 +468,379 @@ private:
 		// Copy the samples to the output array
 		SIZE_TYPE targetSize = copyEliminated ? inputSize : outputSize;
 		for ( SIZE_TYPE i=0; i<targetSize; i++ ) {
-			outputPoints[i] = inputPoints[ heap.GetIDFromHeap(i) ];
+			SIZE_TYPE id = heap.GetIDFromHeap(i);
+			if ( outputPoints  ) outputPoints[i] = inputPoints[id];
+			if ( outputIndices ) outputIndices[i] = id;
+		}
+	}
+
+	// Performs weighted sample elimination by partitioning the sampling domain into slabs.
+	template <typename WeightFunction>
+	void DoEliminateParallel( 
+		const PointType *inputPoints, 
+		SIZE_TYPE        inputSize, 
+		PointType       *outputPoints, 
+		SIZE_TYPE        outputSize, 
+		FType            d_max,
+		WeightFunction   weightFunction
+		) const
+	{
+		// Split the sampling domain along its longest axis
+		int axis = 0;
+		for ( int d=1; d<DIMENSIONS; d++ ) if ( boundsMax[d]-boundsMin[d] > boundsMax[axis]-boundsMin[axis] ) axis = d;
+		const FType domainMin  = boundsMin[axis];
+		const FType domainSize = boundsMax[axis] - boundsMin[axis];
+		int slabCount = partitionCount;
+		if ( FType(slabCount) * 2 * d_max > domainSize ) slabCount = int( domainSize / (2*d_max) );
+		if ( slabCount <= 1 ) {
+			DoEliminate( inputPoints, inputSize, outputPoints, outputSize, d_max, weightFunction, false );
+			return;
+		}
+		const FType slabSize = domainSize / FType(slabCount);
+
+		// Collect the samples of each slab, followed by the samples of the neighboring slabs within 2*d_max.
+		// When tiling, the first and the last slabs are neighbors, so their halo samples are shifted
+		// outside of the sampling domain and the slabs are not tiled along the partition axis.
+		struct Slab {
+			std::vector<PointType> points;		// The samples of the slab, followed by the halo samples
+			std::vector<SIZE_TYPE> index;		// The input index of each sample
+			std::vector<SIZE_TYPE> selected;	// The input indices of the selected samples of the slab
+			SIZE_TYPE ownedCount;				// The number of samples in the slab, excluding the halo
+		};
+		std::vector<Slab> slabs( slabCount );
+		auto SlabID = [&]( FType x ) {
+			int s = int( cyFloor( (x - domainMin) / slabSize ) );
+			return s < 0 ? 0 : ( s >= slabCount ? slabCount-1 : s );
+		};
+		for ( SIZE_TYPE i=0; i<inputSize; i++ ) {
+			Slab &slab = slabs[ SlabID( inputPoints[i][axis] ) ];
+			slab.points.push_back( inputPoints[i] );
+			slab.index.push_back( i );
+		}
+		for ( int s=0; s<slabCount; s++ ) slabs[s].ownedCount = (SIZE_TYPE) slabs[s].index.size();
+		for ( int s=0; s<slabCount; s++ ) {
+			FType slabMin = domainMin + FType(s) * slabSize;
+			FType slabMax = slabMin + slabSize;
+			for ( SIZE_TYPE j=0; j<slabs[s].ownedCount; j++ ) {
+				const PointType &p = slabs[s].points[j];
+				SIZE_TYPE i = slabs[s].index[j];
+				if ( p[axis] - slabMin < 2*d_max ) {
+					if ( s > 0 ) { slabs[s-1].points.push_back( p ); slabs[s-1].index.push_back( i ); }
+					else if ( tiling ) { PointType t = p; t[axis] += domainSize; slabs[slabCount-1].points.push_back( t ); slabs[slabCount-1].index.push_back( i ); }
+				}
+				if ( slabMax - p[axis] < 2*d_max ) {
+					if ( s < slabCount-1 ) { slabs[s+1].points.push_back( p ); slabs[s+1].index.push_back( i ); }
+					else if ( tiling ) { PointType t = p; t[axis] -= domainSize; slabs[0].points.push_back( t ); slabs[0].index.push_back( i ); }
+				}
+			}
+		}
+
+		// Eliminate the samples of each slab, including the halo, in parallel.
+		// Samples near the outer edges of the halo are less likely to be eliminated, so the slab is
+		// eliminated a bit further and the last eliminated samples are brought back in reverse order,
+		// until the number of selected samples in the slab is proportional to its input sample count.
+		const FType ratio = FType(outputSize) / FType(inputSize);
+		ParallelForRanges( 0, slabCount, slabCount, [&]( int s, int, int ) {
+			Slab &slab = slabs[s];
+			SIZE_TYPE count = (SIZE_TYPE) slab.points.size();
+			SIZE_TYPE ownedTarget = SIZE_TYPE( FType(slab.ownedCount) * ratio + FType(0.5) );
+			if ( ownedTarget == 0 ) return;
+			SIZE_TYPE target = SIZE_TYPE( FType(count) * ratio * FType(0.9) );
+			std::vector<SIZE_TYPE> order( count );
+			if ( target > 0 && target < count ) DoEliminate( slab.points.data(), count, nullptr, target, d_max, weightFunction, true, order.data(), axis );
+			else for ( SIZE_TYPE i=0; i<count; i++ ) order[i] = i;
+			for ( SIZE_TYPE i=0; i<count && slab.selected.size()<ownedTarget; i++ ) {
+				if ( order[i] < slab.ownedCount ) slab.selected.push_back( slab.index[ order[i] ] );
+			}
+			std::vector<PointType>().swap( slab.points );
+			std::vector<SIZE_TYPE>().swap( slab.index );
+		} );
+
+		// Keep the selected samples away from the slab boundaries and
+		// repeat the elimination for all input samples within d_max of the slab boundaries.
+		auto BoundaryDistance = [&]( const PointType &p ) {
+			FType t = (p[axis] - domainMin) / slabSize;
+			int b = int( cyFloor( t + FType(0.5) ) );
+			if ( !tiling ) b = b < 1 ? 1 : ( b > slabCount-1 ? slabCount-1 : b );
+			return cyAbs( t - FType(b) ) * slabSize;
+		};
+		std::vector<SIZE_TYPE> selected, candidates;
+		for ( int s=0; s<slabCount; s++ ) {
+			for ( SIZE_TYPE i : slabs[s].selected ) if ( BoundaryDistance( inputPoints[i] ) >= d_max ) selected.push_back(i);
+		}
+		slabs.clear();
+		for ( SIZE_TYPE i=0; i<inputSize; i++ ) if ( BoundaryDistance( inputPoints[i] ) < d_max ) candidates.push_back(i);
+		if ( selected.size() > outputSize || selected.size() + candidates.size() <= outputSize ) {
+			// This can only happen with extremely non-uniform inputs
+			DoEliminate( inputPoints, inputSize, outputPoints, outputSize, d_max, weightFunction, false );
+			return;
+		}
+		EliminateCandidates( inputPoints, candidates, selected, outputSize - (SIZE_TYPE) selected.size(), d_max, weightFunction, BoundaryDistance );
+		SIZE_TYPE n = 0;
+		for ( SIZE_TYPE i : selected   ) outputPoints[n++] = inputPoints[i];
+		for ( SIZE_TYPE i : candidates ) outputPoints[n++] = inputPoints[i];
+	}
+
+	// Performs weighted sample elimination using the given radius of each sample.
+	template <typename WeightFunction>
+	void DoEliminateAdaptive(
+		const PointType *inputPoints,
+		SIZE_TYPE        inputSize,
+		PointType       *outputPoints,
+		SIZE_TYPE        outputSize,
+		const FType     *radius,
+		WeightFunction  &weightFunction
+		) const
+	{
+		// Build a k-d tree for samples
+		PointCloud<PointType,FType,DIMENSIONS,SIZE_TYPE> kdtree;
+		kdtree.Build( inputSize, inputPoints );
+
+		// Assign weights to each sample using its own radius
+		NeighborLists neighbors;
+		CacheNeighbors( kdtree, inputPoints, inputSize, FType(0), weightFunction, neighbors, -1, radius );
+		std::vector<FType> w( inputSize, FType(0) );
+		ParallelFor( SIZE_TYPE(0), inputSize, [&w,&neighbors]( SIZE_TYPE i ) {
+			FType sum = FType(0);
+			for ( SIZE_TYPE j=neighbors.start[i]; j<neighbors.start[i+1]; j++ ) sum += neighbors.weight[j];
+			w[i] = sum;
+		} );
+
+		// Each sample must update the samples that it contributes to
+		ReverseNeighbors( neighbors );
+
+		// Build a heap for the samples using their weights
+		Heap<FType,SIZE_TYPE> heap;
+		heap.SetDataPointer( w.data(), inputSize );
+		heap.Build();
+
+		// While the number of samples is greater than desired
+		for ( SIZE_TYPE sampleSize = inputSize; sampleSize > outputSize; sampleSize-- ) {
+			SIZE_TYPE index = heap.GetTopItemID();
+			heap.Pop();
+			for ( SIZE_TYPE j=neighbors.start[index]; j<neighbors.start[index+1]; j++ ) {
+				SIZE_TYPE i = neighbors.index[j];
+				w[i] -= neighbors.weight[j];
+				heap.MoveItemDown(i);
+			}
+		}
+
+		// Copy the samples to the output array
+		for ( SIZE_TYPE i=0; i<outputSize; i++ ) outputPoints[i] = inputPoints[ heap.GetIDFromHeap(i) ];
+	}
+
+	// Orders the given samples for progressive sampling by eliminating half of the remaining samples repeatedly.
+	// A k-d tree is built for the remaining samples and reused for the following rounds, skipping the samples
+	// eliminated in earlier rounds, until the remaining samples are less than a quarter of the tree size.
+	// Since tiling uses periodic queries, the tree does not depend on d_max.
+	// The heap and the weights array are reused for all rounds.
+	template <typename WeightFunction>
+	void DoEliminateProgressive(
+		PointType       *points,
+		SIZE_TYPE        pointCount,
+		FType            d_max,
+		int              dimensions,
+		WeightFunction   weightFunction
+		) const
+	{
+		const SIZE_TYPE noSlot = SIZE_TYPE(-1);
+		const FType radiusMultiplier = ProgressiveRadiusMultiplier( dimensions );
+		std::vector<PointType> sample( points, points + pointCount );	// positions of the samples, indexed by sample id
+		std::vector<SIZE_TYPE> active( pointCount );						// ids of the remaining samples
+		std::vector<SIZE_TYPE> slot( pointCount, noSlot );				// position of each remaining sample in the active list
+		for ( SIZE_TYPE i=0; i<pointCount; i++ ) active[i] = i;
+		std::vector<SIZE_TYPE> order;
+		std::vector<FType> w;
+		Heap<FType,SIZE_TYPE> heap;
+		PointCloud<PointType,FType,DIMENSIONS,SIZE_TYPE> kdtree;
+		SIZE_TYPE treeSize = 0;
+
+		SIZE_TYPE inSize = pointCount;
+		while ( inSize >= 3 ) {
+			SIZE_TYPE outSize = inSize / 2;
+			d_max *= radiusMultiplier;
+
+			// Rebuild the k-d tree when most of its samples are eliminated
+			if ( inSize*4 < treeSize || treeSize == 0 ) {
+				treeSize = inSize;
+				std::vector<PointType> point( inSize );
+				std::vector<SIZE_TYPE> index( active.begin(), active.begin()+inSize );
+				for ( SIZE_TYPE i=0; i<inSize; i++ ) point[i] = sample[ active[i] ];
+				kdtree.Build( inSize, point.data(), index.data() );
+			}
+			for ( SIZE_TYPE i=0; i<inSize; i++ ) slot[ active[i] ] = i;
+
+			// Assign weights to the remaining samples
+			w.assign( inSize, FType(0) );
+			ForEachSample( inSize, [&]( SIZE_TYPE index ) {
+				SIZE_TYPE id = active[index];
+				const PointType &p0 = sample[id];
+				GetNeighbors( kdtree, p0, d_max, [&]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+					if ( i != id && slot[i] != noSlot ) w[index] += weightFunction(p0,p,d2,d_max);
+				} );
+			} );
+
+			// Eliminate half of the remaining samples
+			heap.SetDataPointer( w.data(), inSize );
+			heap.Build();
+			for ( SIZE_TYPE sampleSize = inSize; sampleSize > outSize; sampleSize-- ) {
+				SIZE_TYPE index = heap.GetTopItemID();
+				heap.Pop();
+				SIZE_TYPE id = active[index];
+				const PointType &p0 = sample[id];
+				GetNeighbors( kdtree, p0, d_max, [&]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+					if ( i == id || slot[i] == noSlot ) return;
+					w[ slot[i] ] -= weightFunction(p0,p,d2,d_max);
+					heap.MoveItemDown( slot[i] );
+				} );
+			}
+
+			// Copy the eliminated samples in order and keep the remaining ones for the next round
+			order.resize( inSize );
+			for ( SIZE_TYPE i=0; i<inSize; i++ ) order[i] = active[ heap.GetIDFromHeap(i) ];
+			for ( SIZE_TYPE i=outSize; i<inSize; i++ ) {
+				points[i] = sample[ order[i] ];
+				slot[ order[i] ] = noSlot;
+			}
+			std::copy( order.begin(), order.begin()+outSize, active.begin() );
+			inSize = outSize;
+		}
+		for ( SIZE_TYPE i=0; i<inSize; i++ ) points[i] = sample[ active[i] ];
+	}
+
+	// Eliminates samples from the candidates list until the given number of candidates remain.
+	// The weights are computed using both the candidates and the fixed samples within 2*d_max of a partition boundary,
+	// but the fixed samples are never eliminated.
+	template <typename WeightFunction, typename BoundaryDistance>
+	void EliminateCandidates(
+		const PointType              *inputPoints,
+		std::vector<SIZE_TYPE>       &candidates,
+		const std::vector<SIZE_TYPE> &fixed,
+		SIZE_TYPE                     outputSize,
+		FType                         d_max,
+		WeightFunction               &weightFunction,
+		BoundaryDistance              boundaryDistance
+		) const
+	{
+		// Collect the samples, placing the candidates first
+		SIZE_TYPE candidateCount = (SIZE_TYPE) candidates.size();
+		std::vector<PointType> point;
+		for ( SIZE_TYPE i : candidates ) point.push_back( inputPoints[i] );
+		for ( SIZE_TYPE i : fixed ) if ( boundaryDistance( inputPoints[i] ) < 2*d_max ) point.push_back( inputPoints[i] );
+		PointCloud<PointType,FType,DIMENSIONS,SIZE_TYPE> kdtree;
+		kdtree.Build( (SIZE_TYPE) point.size(), point.data() );
+
+		// Assign weights to the candidates and eliminate them
+		std::vector<FType> w( candidateCount, FType(0) );
+		ParallelFor( SIZE_TYPE(0), candidateCount, [&]( SIZE_TYPE index ) {
+			const PointType &p0 = point[index];
+			GetNeighbors( kdtree, p0, d_max, [&]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+				if ( i != index ) w[index] += weightFunction(p0,p,d2,d_max);
+			} );
+		} );
+		Heap<FType,SIZE_TYPE> heap;
+		heap.SetDataPointer( w.data(), candidateCount );
+		heap.Build();
+		for ( SIZE_TYPE sampleSize = candidateCount; sampleSize > outputSize; sampleSize-- ) {
+			SIZE_TYPE index = heap.GetTopItemID();
+			heap.Pop();
+			const PointType &p0 = point[index];
+			GetNeighbors( kdtree, p0, d_max, [&]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+				if ( i >= candidateCount || i == index ) return;
+				w[i] -= weightFunction(p0,p,d2,d_max);
+				heap.MoveItemDown(i);
+			} );
+		}
+		std::vector<SIZE_TYPE> remaining( outputSize );
+		for ( SIZE_TYPE i=0; i<outputSize; i++ ) remaining[i] = candidates[ heap.GetIDFromHeap(i) ];
+		candidates.swap( remaining );
+	}
+
+	// Calls the given body for each sample index that computes the initial weight of the sample. The samples are
+	// processed in parallel only if neighbor caching is on, since the weight function may not be thread-safe otherwise.
+	template <typename BODY>
+	void ForEachSample( SIZE_TYPE count, BODY body ) const
+	{
+		if ( neighborCaching ) ParallelFor( SIZE_TYPE(0), count, body );
+		else for ( SIZE_TYPE i=0; i<count; i++ ) body(i);
+	}
+
+	// Keeps the neighbors of each sample in compressed sparse row format.
+	// The neighbors of sample i are between start[i] and start[i+1], excluding the sample itself.
+	struct NeighborLists
+	{
+		std::vector<SIZE_TYPE> start;	// The first neighbor of each sample, followed by the total neighbor count.
+		std::vector<SIZE_TYPE> index;	// The index of each neighbor.
+		std::vector<FType>     weight;	// The weight contribution of each sample to its neighbor.
+	};
+
+	// Finds the neighbors of all samples within d_max radius and computes their weights.
+	// The samples are processed in parallel only if neighbor caching is on (see ForEachSample).
+	// If the radius array is not null, the neighbors of each sample are found within its own radius.
+	template <typename KDTree, typename WeightFunction>
+	void CacheNeighbors(
+		KDTree          &kdtree,
+		const PointType *inputPoints,
+		SIZE_TYPE        inputSize,
+		FType            d_max,
+		WeightFunction  &weightFunction,
+		NeighborLists   &neighbors,
+		int              openAxis,
+		const FType     *radius = nullptr
+		) const
+	{
+		// Each range collects the neighbors of its samples into its own buffers
+		int rangeCount = neighborCaching ? ParallelRangeCount( inputSize ) : 1;
+		std::vector<NeighborLists> rangeLists( rangeCount );
+		neighbors.start.resize( inputSize+1 );
+		ParallelForRanges( SIZE_TYPE(0), inputSize, rangeCount, [&]( int r, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+			NeighborLists &list = rangeLists[r];
+			for ( SIZE_TYPE index=rangeBegin; index<rangeEnd; index++ ) {
+				const PointType &point = inputPoints[index];
+				const FType sampleRadius = radius ? radius[index] : d_max;
+				neighbors.start[index] = (SIZE_TYPE) list.index.size();	// local offset, fixed below
+				GetNeighbors( kdtree, point, sampleRadius, [&]( SIZE_TYPE i, const PointType &p, FType d2, FType & ){
+					if ( i == index ) return;
+					list.index.push_back( i );
+					list.weight.push_back( weightFunction(point,p,d2,sampleRadius) );
+				}, openAxis );
+			}
+		} );
+
+		// Compute the global offset of each range and copy the neighbors
+		std::vector<SIZE_TYPE> rangeOffset( rangeCount+1, SIZE_TYPE(0) );
+		for ( int r=0; r<rangeCount; r++ ) rangeOffset[r+1] = rangeOffset[r] + (SIZE_TYPE) rangeLists[r].index.size();
+		neighbors.index .resize( rangeOffset[rangeCount] );
+		neighbors.weight.resize( rangeOffset[rangeCount] );
+		neighbors.start[inputSize] = rangeOffset[rangeCount];
+		ParallelForRanges( SIZE_TYPE(0), inputSize, rangeCount, [&]( int r, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+			const NeighborLists &list = rangeLists[r];
+			for ( SIZE_TYPE i=rangeBegin; i<rangeEnd; i++ ) neighbors.start[i] += rangeOffset[r];
+			std::copy( list.index .begin(), list.index .end(), neighbors.index .begin() + rangeOffset[r] );
+			std::copy( list.weight.begin(), list.weight.end(), neighbors.weight.begin() + rangeOffset[r] );
+		} );
+	}
+
+	// Reverses the neighbor lists, such that the list of each sample contains the samples that have it
+	// in their neighbor lists, along with its weight contribution to them.
+	void ReverseNeighbors( NeighborLists &neighbors ) const
+	{
+		SIZE_TYPE sampleCount = (SIZE_TYPE) neighbors.start.size() - 1;
+		NeighborLists reversed;
+		reversed.start.assign( sampleCount+1, SIZE_TYPE(0) );
+		for ( SIZE_TYPE i : neighbors.index ) reversed.start[i+1]++;
+		for ( SIZE_TYPE i=0; i<sampleCount; i++ ) reversed.start[i+1] += reversed.start[i];
+		reversed.index .resize( neighbors.index.size() );
+		reversed.weight.resize( neighbors.index.size() );
+		std::vector<SIZE_TYPE> pos( reversed.start.begin(), reversed.start.end()-1 );
+		for ( SIZE_TYPE i=0; i<sampleCount; i++ ) {
+			for ( SIZE_TYPE j=neighbors.start[i]; j<neighbors.start[i+1]; j++ ) {
+				SIZE_TYPE k = pos[ neighbors.index[j] ]++;
+				reversed.index [k] = i;
+				reversed.weight[k] = neighbors.weight[j];
+			}
 		}
+		std::swap( neighbors, reversed );
 	}
 
 	// Returns the change in weight function radius using half of the number of samples. It is used for progressive sampling.
@@ -0,0 +1,259 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cySpaceFillingCurve.h
+//! \author Cem Yuksel
+//!
+//! \brief  Spatial sorting using space-filling curves.
+//!
+//! This file includes functions that compute 3D Morton (Z-order) and Hilbert
+//! curve keys and sort points along these curves using a parallel radix sort.
+//! Storing spatially close elements next to each other in memory improves the
+//! cache use of the algorithms that access the neighbors of an element.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_SPACE_FILLING_CURVE_H_INCLUDED_
+#define _CY_SPACE_FILLING_CURVE_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyPoint.h"
+#include <stdint.h>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Space-filling curve types
+enum SpaceFillingCurve {
+	SFC_MORTON,		//!< Morton (Z-order) curve, which interleaves the bits of the coordinates. It is much faster to compute.
+	SFC_HILBERT,	//!< Hilbert curve, which only moves between neighboring cells, so it does not have the long jumps of the Morton curve.
+};
+
+//! Number of bits of each coordinate used by the 3D curve keys
+#define _CY_SFC_BITS 21
+
+//-------------------------------------------------------------------------------
+
+//! Returns the 3D Morton key of the given cell coordinates. Only the lowest 21 bits of
+//! each coordinate are used, so the key has 63 bits. The bits of x are the lowest.
+inline uint64_t MortonKey3( uint32_t x, uint32_t y, uint32_t z )
+{
+	auto Spread = []( uint64_t a ) {
+		a &= 0x1FFFFF;
+		a = ( a | a << 32 ) & 0x001F00000000FFFFull;
+		a = ( a | a << 16 ) & 0x001F0000FF0000FFull;
+		a = ( a | a <<  8 ) & 0x100F00F00F00F00Full;
+		a = ( a | a <<  4 ) & 0x10C30C30C30C30C3ull;
+		a = ( a | a <<  2 ) & 0x1249249249249249ull;
+		return a;
+	};
+	return Spread(x) | Spread(y) << 1 | Spread(z) << 2;
+}
+
+//! Returns the 3D Hilbert key of the given cell coordinates. Only the lowest 21 bits of
+//! each coordinate are used, so the key has 63 bits. Consecutive keys belong to neighboring cells.
+//! The key is computed by converting the coordinates to the transposed Hilbert index
+//! (J. Skilling, "Programming the Hilbert curve", 2004) and interleaving its bits.
+inline uint64_t HilbertKey3( uint32_t x, uint32_t y, uint32_t z )
+{
+	uint32_t X[3] = { x & 0x1FFFFF, y & 0x1FFFFF, z & 0x1FFFFF };
+	const uint32_t M = 1u << (_CY_SFC_BITS-1);
+	auto BitMask = []( uint32_t b ) { return 0u - uint32_t( b != 0 ); };	// all bits are set if b is not zero
+	// Inverse undo: for each axis, invert the lower bits of X[0] if the axis has the current bit,
+	// otherwise exchange the lower bits of X[0] and the axis. The branches are replaced by masks.
+	for ( uint32_t Q=M; Q>1; Q>>=1 ) {
+		const uint32_t P = Q - 1;
+		X[0] ^= P & BitMask( X[0] & Q );
+		for ( int i=1; i<3; i++ ) {
+			uint32_t m = BitMask( X[i] & Q );
+			uint32_t t = ( X[0] ^ X[i] ) & P & ~m;
+			X[0] ^= ( P & m ) | t;
+			X[i] ^= t;
+		}
+	}
+	// Gray encode
+	X[1] ^= X[0];
+	X[2] ^= X[1];
+	uint32_t t = 0;
+	for ( uint32_t Q=M; Q>1; Q>>=1 ) t ^= ( Q-1 ) & BitMask( X[2] & Q );
+	for ( int i=0; i<3; i++ ) X[i] ^= t;
+	// The bits of X[0] are the most significant bits of each group of three bits
+	return MortonKey3( X[2], X[1], X[0] );
+}
+
+//-------------------------------------------------------------------------------
+
+//! Sorts the given keys using a parallel radix sort and writes the indices of the keys in sorted order
+//! to the order array, so that keys[order[0]] is the smallest key. The sort is stable, so the keys
+//! that are equal keep their index order and the result does not depend on the number of threads.
+//! Only the lowest keyBits bits of the keys are used. The order array must have at least count elements.
+template <typename SIZE_TYPE>
+inline void RadixSortOrder( const uint64_t *keys, SIZE_TYPE count, SIZE_TYPE *order, int keyBits=64 )
+{
+	if ( count == 0 ) return;
+	struct Entry { uint64_t key; SIZE_TYPE index; };
+	std::vector<Entry> entries( count ), temp( count );
+	const uint64_t keyMask = keyBits < 64 ? ( uint64_t(1) << keyBits ) - 1 : ~uint64_t(0);
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) { entries[i].key = keys[i] & keyMask; entries[i].index = i; } );
+
+	// Each pass sorts the entries by 11 bits of the keys. The ranges of entries count their digits
+	// and then scatter them to the positions that follow the same digit of the previous ranges.
+	const int DIGIT_BITS = 11, RADIX = 1 << DIGIT_BITS;
+	const int rangeCount = ParallelRangeCount( size_t(count) );
+	std::vector<SIZE_TYPE> histogram( size_t(rangeCount) * RADIX );
+	for ( int shift=0; shift<keyBits; shift+=DIGIT_BITS ) {
+		ParallelForRanges( SIZE_TYPE(0), count, rangeCount, [&]( int r, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+			SIZE_TYPE *h = histogram.data() + size_t(r)*RADIX;
+			for ( int d=0; d<RADIX; d++ ) h[d] = 0;
+			for ( SIZE_TYPE i=rangeBegin; i<rangeEnd; i++ ) h[ ( entries[i].key >> shift ) & (RADIX-1) ]++;
+		} );
+		// Skip the pass if all keys have the same digit
+		SIZE_TYPE start = 0;
+		bool skip = false;
+		for ( int d=0; d<RADIX && !skip; d++ ) {
+			SIZE_TYPE digitCount = 0;
+			for ( int r=0; r<rangeCount; r++ ) {
+				SIZE_TYPE &h = histogram[ size_t(r)*RADIX + d ];
+				SIZE_TYPE c = h;
+				h = start;
+				start += c;
+				digitCount += c;
+			}
+			skip = digitCount == count;
+		}
+		if ( skip ) continue;
+		ParallelForRanges( SIZE_TYPE(0), count, rangeCount, [&]( int r, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+			SIZE_TYPE *h = histogram.data() + size_t(r)*RADIX;
+			for ( SIZE_TYPE i=rangeBegin; i<rangeEnd; i++ ) temp[ h[ ( entries[i].key >> shift ) & (RADIX-1) ]++ ] = entries[i];
+		} );
+		entries.swap( temp );
+	}
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) { order[i] = entries[i].index; } );
+}
+
+//-------------------------------------------------------------------------------
+
+//! Computes the order of the given points along the given space-filling curve. The points are
+//! normalized using the given bounding box, which is extended to a cube, and quantized to a grid
+//! of 2^21 cells along each axis. The order array receives the indices of the points in sorted order,
+//! so order[0] is the index of the first point along the curve. The points with the same key keep
+//! their index order. The order array must have at least count elements.
+template <typename TYPE, typename SIZE_TYPE>
+inline void SpatialSortOrder( const Point3<TYPE> *points, SIZE_TYPE count, SIZE_TYPE *order, SpaceFillingCurve curve, const Point3<TYPE> &boundMin, const Point3<TYPE> &boundMax )
+{
+	if ( count == 0 ) return;
+	const TYPE maxCell = TYPE( (1u << _CY_SFC_BITS) - 1 );
+	const TYPE size = ( boundMax - boundMin ).Max();
+	const TYPE scale = size > TYPE(0) ? maxCell / size : TYPE(0);
+	auto Quantize = [&]( TYPE c, TYPE cmin ) {
+		TYPE q = ( c - cmin ) * scale;
+		return q > TYPE(0) ? ( q < maxCell ? uint32_t(q) : uint32_t(maxCell) ) : 0u;	// NaN is mapped to zero
+	};
+	std::vector<uint64_t> keys( count );
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) {
+		const Point3<TYPE> &p = points[i];
+		uint32_t x = Quantize( p.x, boundMin.x );
+		uint32_t y = Quantize( p.y, boundMin.y );
+		uint32_t z = Quantize( p.z, boundMin.z );
+		keys[i] = curve == SFC_HILBERT ? HilbertKey3(x,y,z) : MortonKey3(x,y,z);
+	} );
+	RadixSortOrder( keys.data(), count, order, 3*_CY_SFC_BITS );
+}
+
+//! Computes the bounding box of the given points in parallel. Returns false if there are no points.
+template <typename TYPE, typename SIZE_TYPE>
+inline bool ComputeBounds( const Point3<TYPE> *points, SIZE_TYPE count, Point3<TYPE> &boundMin, Point3<TYPE> &boundMax )
+{
+	if ( count == 0 ) return false;
+	auto Include = []( Point3<TYPE> &pmin, Point3<TYPE> &pmax, const Point3<TYPE> &p ) {
+		if ( pmin.x > p.x ) pmin.x = p.x;
+		if ( pmin.y > p.y ) pmin.y = p.y;
+		if ( pmin.z > p.z ) pmin.z = p.z;
+		if ( pmax.x < p.x ) pmax.x = p.x;
+		if ( pmax.y < p.y ) pmax.y = p.y;
+		if ( pmax.z < p.z ) pmax.z = p.z;
+	};
+	const int rangeCount = ParallelRangeCount( size_t(count) );
+	std::vector<Point3<TYPE>> rangeMin( rangeCount, points[0] ), rangeMax( rangeCount, points[0] );
+	ParallelForRanges( SIZE_TYPE(0), count, rangeCount, [&]( int r, SIZE_TYPE rangeBegin, SIZE_TYPE rangeEnd ) {
+		Point3<TYPE> pmin = points[rangeBegin], pmax = points[rangeBegin];
+		for ( SIZE_TYPE i=rangeBegin+1; i<rangeEnd; i++ ) Include( pmin, pmax, points[i] );
+		rangeMin[r] = pmin;
+		rangeMax[r] = pmax;
+	} );
+	boundMin = rangeMin[0];
+	boundMax = rangeMax[0];
+	for ( int r=1; r<rangeCount; r++ ) { Include( boundMin, boundMax, rangeMin[r] ); Include( boundMin, boundMax, rangeMax[r] ); }
+	return true;
+}
+
+//! Computes the order of the given points along the given space-filling curve within their bounding box.
+template <typename TYPE, typename SIZE_TYPE>
+inline void SpatialSortOrder( const Point3<TYPE> *points, SIZE_TYPE count, SIZE_TYPE *order, SpaceFillingCurve curve=SFC_MORTON )
+{
+	Point3<TYPE> boundMin, boundMax;
+	if ( ComputeBounds( points, count, boundMin, boundMax ) ) SpatialSortOrder( points, count, order, curve, boundMin, boundMax );
+}
+
+//-------------------------------------------------------------------------------
+
+//! Reorders the given items, such that the i^th item becomes the item at index order[i].
+//! The order array must be a permutation of the item indices, such as the one computed by SpatialSortOrder.
+template <typename T, typename SIZE_TYPE>
+inline void ApplyOrder( T *items, SIZE_TYPE count, const SIZE_TYPE *order )
+{
+	std::vector<T> temp( items, items + count );
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) { items[i] = temp[ order[i] ]; } );
+}
+
+//! Computes the new index of each item after reordering with the given order, such that newIndex[order[i]] = i.
+//! It can be used for remapping the indices that refer to the reordered items.
+template <typename SIZE_TYPE>
+inline void InvertOrder( const SIZE_TYPE *order, SIZE_TYPE count, SIZE_TYPE *newIndex )
+{
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) { newIndex[ order[i] ] = i; } );
+}
+
+//! Sorts the given points along the given space-filling curve. If the order array is not NULL,
+//! it receives the original index of each sorted point (see SpatialSortOrder).
+template <typename TYPE, typename SIZE_TYPE>
+inline void SpatialSortPoints( Point3<TYPE> *points, SIZE_TYPE count, SpaceFillingCurve curve=SFC_MORTON, SIZE_TYPE *order=NULL )
+{
+	std::vector<SIZE_TYPE> sortOrder( order ? 0 : count );
+	if ( ! order ) order = sortOrder.data();
+	SpatialSortOrder( points, count, order, curve );
+	ApplyOrder( points, count, order );
+}
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+#endif
@@ -37,9 +37,19 @@
 //-------------------------------------------------------------------------------
 
 #include "cyPoint.h"
+#include "cyMappedFile.h"
+#include "cyVertexWeld.h"
+#include "cySpaceFillingCurve.h"
+#include "cyPointSoA.h"
 #include <stdio.h>
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
 
 //-------------------------------------------------------------------------------
@@ -91,6 +101,29 @@ public:
 		}
 	};
 
+	//! Callbacks for reading OBJ files with StreamFromFileObj.
+	//! The default implementations ignore the data. A callback can return false to stop reading.
+	class ObjStreamCallbacks
+	{
+	public:
+		virtual ~ObjStreamCallbacks() {}
+		//! Receives the given number of vertices, starting with the vertex at index firstIndex.
+		virtual bool Vertices ( const Point3f * /*v*/,  unsigned int /*count*/, uint64_t /*firstIndex*/) { return true; }
+		//! Receives the given number of texture vertices, starting with the texture vertex at index firstIndex.
+		virtual bool TexVerts ( const Point3f * /*vt*/, unsigned int /*count*/, uint64_t /*firstIndex*/) { return true; }
+		//! Receives the given number of vertex normals, starting with the vertex normal at index firstIndex.
+		virtual bool Normals  ( const Point3f * /*vn*/, unsigned int /*count*/, uint64_t /*firstIndex*/) { return true; }
+		//! Receives the given number of triangles, starting with the triangle at index firstIndex.
+		//! The texture and normal faces are NULL if no texture vertices or normals are read so far.
+		//! The vertex indices are zero-based and relative (negative) indices are resolved.
+		virtual bool Faces    ( const TriFace * /*f*/, const TriFace * /*ft*/, const TriFace * /*fn*/, unsigned int /*count*/, uint64_t /*firstIndex*/) { return true; }
+		//! Receives the name of the material used by the following triangles, starting with the triangle at index firstFace.
+		//! The name is empty if the material is not specified.
+		virtual bool Material ( const char * /*name*/, uint64_t /*firstFace*/) { return true; }
+		//! Receives the name of a material library file.
+		virtual bool MaterialLibrary( const char * /*filename*/) { return true; }
+	};
+
 protected:
 	Point3f *v;		//!< vertices
 	TriFace *f;		//!< faces
@@ -145,12 +178,15 @@ public:
 	bool HasTextureVertices() const { return NVT() > 0; }	//!< returns true if the mesh has texture vertices
 
 	//!@name Set Component Count
-	void Clear() { SetNumVertex(0); SetNumFaces(0); SetNumNormals(0); SetNumTexVerts(0); SetNumMtls(0); boundMin.Zero(); boundMax.Zero(); }
+	void Clear() { SetNumVertex(0); SetNumFaces(0); SetNumNormals(0); SetNumTexVerts(0); SetNumMtls(0); boundMin.Zero(); boundMax.Zero(); mappedFile.Close(); }
 	void SetNumVertex  (unsigned int n) { Allocate(n,v,nv); }
 	void SetNumFaces   (unsigned int n) { Allocate(n,f,nf); if (fn||vn) Allocate(n,fn); if (ft||vt) Allocate(n,ft); }
 	void SetNumNormals (unsigned int n) { Allocate(n,vn,nvn); if (!fn) Allocate(nf,fn); }
 	void SetNumTexVerts(unsigned int n) { Allocate(n,vt,nvt); if (!ft) Allocate(nf,ft); }
 	void SetNumMtls    (unsigned int n) { Allocate(n,m,nm); Allocate(n,mcfc); }
+	//! Sets the cumulative face count of the given material, which is the index after the last face of the material.
+	//! The faces of the next material start at this index.
+	void SetMaterialCumulativeFaceCount(int mtlID, int faceCount) { mcfc[mtlID] = faceCount; }
 
 	//!@name Get Property Methods
 	bool    IsBoundBoxReady() const { return boundMin.x!=0 && boundMin.y!=0 && boundMin.z!=0 && boundMax.x!=0 && boundMax.y!=0 && boundMax.z!=0; }
@@ -164,17 +200,141 @@ public:
 	int     GetMaterialFirstFace(int mtlID) const { return mtlID>0 ? mcfc[mtlID-1] : 0; }	//!< Returns the first face index associated with the given material ID. Other faces associated with the same material are placed are placed consecutively.
 
 	//!@name Compute Methods
-	void ComputeBoundingBox();						//!< Computes the bounding box
-	void ComputeNormals(bool clockwise=false);		//!< Computes and stores vertex normals
+	//! Weighting of the face normals for computing vertex normals
+	enum NormalWeighting {
+		NORMAL_WEIGHT_AREA,		//!< Face normals are weighted by the face area
+		NORMAL_WEIGHT_ANGLE,	//!< Face normals are weighted by the angle of the face corner at the vertex
+		NORMAL_WEIGHT_EQUAL,	//!< All faces that share the vertex have the same weight
+	};
+	void ComputeBoundingBox();						//!< Computes the bounding box. The vertices are processed in blocks as independent lanes, so the loop is vectorized.
+	//! Computes and stores vertex normals.
+	//! The normals are computed in parallel by gathering the faces of each vertex in face order, so the results do not depend on the number of threads.
+	void ComputeNormals(bool clockwise=false, NormalWeighting weighting=NORMAL_WEIGHT_AREA);
+	float ComputeACMR(int cacheSize=32) const;		//!< Returns the average cache miss ratio (transformed vertices per triangle) of the faces for a FIFO post-transform vertex cache of the given size.
+
+	//!@name Structure-of-arrays Methods
+	void GetVerticesSoA( Point3fSoA &verts ) const { verts.Set( v, nv ); }										//!< Copies the vertices to the given structure-of-arrays storage, which can be used with the vectorized kernels of Point3SoA.
+	void SetVerticesSoA( const Point3fSoA &verts ) { SetNumVertex( (unsigned int) verts.Size() ); verts.Get( v ); }	//!< Sets the vertices by copying them from the given structure-of-arrays storage. The faces are not changed.
+	//! Computes the area-weighted vertex normals of the faces for the given vertex positions in structure-of-arrays storage (see Point3SoA::ComputeVertexNormals).
+	//! The mesh is not changed.
+	void ComputeNormals( const Point3fSoA &verts, Point3fSoA &normals, bool clockwise=false ) const { normals.ComputeVertexNormals( verts, nf > 0 ? f[0].v : NULL, nf, clockwise ); }
+
+	//!@name Optimization Methods
+	//! Reorders the faces for post-transform vertex cache locality using Tom Forsyth's linear-speed vertex cache optimization.
+	//! The faces are reordered within each material, so the material face ranges (mcfc) are kept.
+	//! The normal and texture faces are reordered with the faces.
+	void OptimizeFaceOrder(int cacheSize=32);
+	void OptimizeVertexOrder();						//!< Reorders the vertices, the texture vertices, and the vertex normals in the order of their first use by the faces, so that the faces fetch vertex data sequentially. Unused vertices are moved to the end.
+	void OptimizeVertexCache(int cacheSize=32) { OptimizeFaceOrder(cacheSize); OptimizeVertexOrder(); }	//!< Optimizes the face order and then the vertex order.
+	//! Reorders the vertices along the given space-filling curve within their bounding box (see SpatialSortOrder) and remaps the faces.
+	//! The texture vertices and the vertex normals are reordered with the vertices only if their faces are the same as the vertex faces (as after ComputeNormals).
+	void SpatialSortVertices(SpaceFillingCurve curve=SFC_MORTON);
+	//! Reorders the faces along the given space-filling curve using the centers of the faces within the bounding box of the vertices.
+	//! The faces are reordered within each material, so the material face ranges (mcfc) are kept.
+	//! The normal and texture faces are reordered with the faces.
+	void SpatialSortFaces(SpaceFillingCurve curve=SFC_MORTON);
+	//! Merges the vertices that are within the given distance (see WeldPoints) and remaps the faces.
+	//! Optionally, merges the texture vertices and the vertex normals with exactly the same values and remaps the texture and normal faces.
+	//! Faces that become degenerate are kept.
+	void WeldVertices(float tolerance=0, bool weldTexVerts=true, bool weldNormals=true);
+
+	//!@name Editing Methods
+	void DeleteFaces( const bool *deleteFace );	//!< Deletes the faces for which deleteFace[i] is true, along with their normal and texture faces. The remaining faces keep their order and the material face ranges are updated.
+	void DeleteUnusedVertices();				//!< Deletes the vertices, the texture vertices, and the vertex normals that are not used by any face and remaps the faces. The remaining vertices keep their order.
 
 	//!@name Load and Save methods
-	bool LoadFromFileObj( const char *filename, bool loadMtl=true );	//!< Loads the mesh from an OBJ file. Automatically converts all faces to triangles.
-	bool SaveToFileObj( const char *filename );
+	//! Loads the mesh from an OBJ file.
+	//! Automatically converts all faces to triangles.
+	//! Large files are parsed in parallel (see ParallelThreadCount).
+	//! If useCache is true, the mesh is loaded from the binary cache file next to the OBJ file (filename.cymesh), if the cache was created from an OBJ file with the same modification time and size.
+	//! Otherwise, the OBJ file is parsed and the cache file is written.
+	//! The cache does not track changes to the .mtl files.
+	bool LoadFromFileObj( const char *filename, bool loadMtl=true, bool useCache=false );
+	//! Saves the mesh to an OBJ file.
+	//! If precision is negative, the numbers are written with the shortest representation that reads back to the same float value.
+	//! Otherwise, the numbers are rounded to the given number of digits after the decimal point, which produces smaller files.
+	//! Large meshes are formatted in parallel chunks (see ParallelThreadCount) that are written in order.
+	bool SaveToFileObj( const char *filename, int precision=-1 );
+	//! Reads an OBJ file in chunks of the given size (in bytes) and passes the data to the callbacks in file order, without keeping the whole mesh in memory.
+	//! The memory use is proportional to the buffer size.
+	//! Each chunk is parsed in parallel (see ParallelThreadCount).
+	//! Within each chunk, the vertices, the texture vertices, and the normals are reported before the faces.
+	//! Faces with more than three vertices are converted to triangles.
+	//! Returns false if the file cannot be read, if a callback returns false, or if the vertex count exceeds the 32-bit index range.
+	static bool StreamFromFileObj( const char *filename, ObjStreamCallbacks &callbacks, size_t bufferSize=1<<24 );
+	//! Loads the mesh from a binary file written by SaveToFileBinary.
+	//! With memory mapping, the mesh arrays point directly into the copy-on-write mapping of the file, so loading does no per-element work and the pages are read when they are first accessed.
+	bool LoadFromFileBinary( const char *filename, bool useMemoryMapping=true ) { return LoadBinary(filename,useMemoryMapping,NULL,0,false); }
+	//! Saves the mesh in a binary format that contains all mesh data, including materials and the bounding box.
+	//! The file uses the byte order of the machine.
+	bool SaveToFileBinary( const char *filename ) const { return SaveBinary(filename,0,0,false); }
 
 private:
-	template <class T> void Allocate(unsigned int n, T* &t) { if (t) delete [] t; if (n>0) t = new T[n]; else t=NULL; }
+	template <class T> void Allocate(unsigned int n, T* &t) { if (t && !mappedFile.Contains(t)) delete [] t; if (n>0) t = new T[n]; else t=NULL; }
 	template <class T> bool Allocate(unsigned int n, T* &t, unsigned int &nt) { if (n==nt) return false; nt=n; Allocate(n,t); return true; }
 	static Point3f Interpolate( int i, const Point3f *v, const TriFace *f, const Point3f &bc ) { return v[f[i].v[0]]*bc.x + v[f[i].v[1]]*bc.y + v[f[i].v[2]]*bc.z; }
+
+	//!@name Internal OBJ parsing structures and methods
+	struct ObjName { const char *str; unsigned int len; };	// A name that points into the file buffer
+	struct ObjRun									// Consecutive faces that use the same material
+	{
+		ObjName      mtl;			// Material name (the first run of a block has no name and continues the previous material)
+		int          mtlID;			// Material index, negative if the faces have no material
+		unsigned int faceCount;		// Number of triangles
+		unsigned int firstFace;		// Index of the first triangle in the face arrays
+	};
+	struct ObjBlock									// A range of lines in the file buffer
+	{
+		const char  *begin, *end;
+		unsigned int nv, nvt, nvn, nf;	// Number of items in the block
+		unsigned int v0, vt0, vn0;		// Number of items before the block
+		std::vector<ObjRun>  runs;
+		std::vector<ObjName> mtlLibs;
+	};
+	enum ObjLineType { OBJ_OTHER, OBJ_V, OBJ_VT, OBJ_VN, OBJ_F, OBJ_USEMTL, OBJ_MTLLIB };
+	static bool        ReadFile( const char *filename, std::vector<char> &data );
+	static void        ObjSplitBlocks( const std::vector<char> &data, std::vector<ObjBlock> &blocks );
+	static void        ObjCountBlock( ObjBlock &block, bool loadMtl );
+	void               ObjParseBlock( const ObjBlock &block, bool loadMtl, unsigned int vBase=0, unsigned int vtBase=0, unsigned int vnBase=0 );
+	static ObjLineType ObjGetLineType( const char *&p );
+	static const char* ObjNextLine  ( const char *p, const char *end ) { while ( p<end && *p!='\n' && *p!='\r' ) p++; while ( p<end && (*p=='\n' || *p=='\r') ) p++; return p; }
+	static const char* ObjSkipSpace ( const char *p ) { while ( *p==' ' || *p=='\t' ) p++; return p; }
+	static bool        ObjIsSpace   ( char c ) { return c==' ' || c=='\t'; }
+	static bool        ObjIsIndex   ( char c ) { return ( c>='0' && c<='9' ) || c=='-' || c=='+'; }
+	static ObjName     ObjParseName ( const char *p );
+	static const char* ObjParseInt  ( const char *p, int &i );
+	static const char* ObjParseFloat( const char *p, float &f );
+	static char*       ObjWriteFloat( char *p, float f, int precision );
+	static char*       ObjWriteUInt ( char *p, uint64_t i ) { char d[20]; int n=0; do { d[n++] = char('0' + i%10); i/=10; } while ( i ); while ( n>0 ) *p++ = d[--n]; return p; }
+	template <typename FORMAT> static bool ObjWriteLines( FILE *fp, unsigned int count, size_t maxLineLength, FORMAT format );
+	static void OptimizeFaceRange( unsigned int faceBegin, unsigned int faceEnd, int cacheSize, const TriFace *faces, std::vector<unsigned int> &localID, std::vector<unsigned int> &order );
+	static void ReorderVertices( Point3f *verts, unsigned int numVerts, TriFace *faces, unsigned int numFaces );
+	void WeldArray( Point3f* &verts, unsigned int &numVerts, TriFace *faces, float tolerance );
+	void DeleteUnusedArray( Point3f* &verts, unsigned int &numVerts, TriFace *faces );
+	template <class T> void Reallocate( unsigned int n, T* &t ) { T *newArray = n>0 ? new T[n] : NULL; if ( t ) for ( unsigned int i=0; i<n; i++ ) newArray[i] = t[i]; Allocate(0,t); t = newArray; }	// keeps the first n items
+	static unsigned int ObjIndex( int i, unsigned int count ) { return i > 0 ? (unsigned int)(i-1) : ( i < 0 && (unsigned int)(-i) <= count ? count - (unsigned int)(-i) : 0 ); }
+
+	//!@name Internal binary file structures and methods
+	enum { BINARY_VERSION = 1, BINARY_ALIGNMENT = 64 };
+	enum { BINARY_HAS_FN = 1, BINARY_HAS_FT = 2, BINARY_LOAD_MTL = 4 };
+	enum { BINARY_V, BINARY_F, BINARY_VN, BINARY_FN, BINARY_VT, BINARY_FT, BINARY_M, BINARY_MCFC, BINARY_ARRAY_COUNT };
+	struct BinaryHeader
+	{
+		char     id[8];				// "CYTRIMSH"
+		uint32_t version;			// BINARY_VERSION
+		uint32_t byteOrder;			// 0x01020304 in the byte order of the machine that wrote the file
+		uint32_t mtlSize;			// sizeof(Mtl)
+		uint32_t flags;
+		uint32_t nv, nf, nvn, nvt, nm;
+		float    boundMin[3], boundMax[3];
+		int64_t  sourceTime;		// Modification time of the OBJ file for cache files
+		uint64_t sourceSize;		// Size of the OBJ file for cache files
+		uint64_t fileSize;
+		uint64_t offset[BINARY_ARRAY_COUNT];	// Byte offsets of the arrays, aligned to BINARY_ALIGNMENT (zero if the array does not exist)
+	};
+	MappedFile mappedFile;	// The binary file that the mesh arrays may point into
+	bool LoadBinary( const char *filename, bool useMemoryMapping, const int64_t *sourceTime, uint64_t sourceSize, bool loadMtl );
+	bool SaveBinary( const char *filename, int64_t sourceTime, uint64_t sourceSize, bool loadMtl ) const;
 };
 
 //-------------------------------------------------------------------------------
@@ -189,9 +349,28 @@ inline int TriMesh::GetMaterialIndex(int faceID) const
 
 inline void TriMesh::ComputeBoundingBox()
 {
-	boundMin=v[0];
-	boundMax=v[0];
-	for ( unsigned int i=1; i<nv; i++ ) {
+	if ( nv == 0 ) { boundMin.Zero(); boundMax.Zero(); return; }
+	// The coordinates of a block of 16 vertices are processed as 48 independent lanes, so the loop is
+	// vectorized without gathering the coordinates. Lane j keeps the bounds of axis j%3.
+	const unsigned int BLOCK = 16, LANES = BLOCK*3;
+	const float *p = &v[0].x;
+	const unsigned int blockCount = nv / BLOCK;
+	float lmin[LANES], lmax[LANES];
+	for ( unsigned int j=0; j<LANES; j++ ) lmin[j] = lmax[j] = p[j%3];
+	for ( unsigned int b=0; b<blockCount; b++ ) {
+		const float *block = p + b*LANES;
+		_CY_IVDEP_FOR ( unsigned int j=0; j<LANES; j++ ) {
+			lmin[j] = block[j] < lmin[j] ? block[j] : lmin[j];
+			lmax[j] = block[j] > lmax[j] ? block[j] : lmax[j];
+		}
+	}
+	boundMin = v[0];
+	boundMax = v[0];
+	for ( unsigned int j=0; j<LANES; j++ ) {
+		if ( boundMin[j%3] > lmin[j] ) boundMin[j%3] = lmin[j];
+		if ( boundMax[j%3] < lmax[j] ) boundMax[j%3] = lmax[j];
+	}
+	for ( unsigned int i=blockCount*BLOCK; i<nv; i++ ) {
 		if ( boundMin.x > v[i].x ) boundMin.x = v[i].x;
 		if ( boundMin.y > v[i].y ) boundMin.y = v[i].y;
 		if ( boundMin.z > v[i].z ) boundMin.z = v[i].z;
@@ -201,258 +380,522 @@ inline void TriMesh::ComputeBoundingBox()
 	}
 }
 
-inline void TriMesh::ComputeNormals(bool clockwise)
+inline void TriMesh::ComputeNormals(bool clockwise, NormalWeighting weighting)
 {
 	SetNumNormals(nv);
-	for ( unsigned int i=0; i<nvn; i++ ) vn[i].Set(0,0,0);	// initialize all normals to zero
-	for ( unsigned int i=0; i<nf; i++ ) {
+	if ( nv == 0 ) return;
+
+	// Returns the face normal, which is normalized, unless the normals are weighted by area.
+	auto FaceNormal = [&]( unsigned int i ) {
 		Point3f N = (v[f[i].v[1]]-v[f[i].v[0]]) ^ (v[f[i].v[2]]-v[f[i].v[0]]);	// face normal (not normalized)
 		if ( clockwise ) N = -N;
-		vn[f[i].v[0]] += N;
-		vn[f[i].v[1]] += N;
-		vn[f[i].v[2]] += N;
+		if ( weighting != NORMAL_WEIGHT_AREA ) {
+			float len = N.Length();
+			if ( len > 0 ) N /= len;
+		}
+		return N;
+	};
+	// Returns the angle of the face corner k
+	auto CornerAngle = [&]( unsigned int i, unsigned int k ) {
+		Point3f e1 = v[ f[i].v[(k+1)%3] ] - v[ f[i].v[k] ];
+		Point3f e2 = v[ f[i].v[(k+2)%3] ] - v[ f[i].v[k] ];
+		return atan2f( (e1^e2).Length(), e1%e2 );
+	};
+
+	if ( ParallelThreadCount() <= 1 || ParallelIsNested() ) {
+		// Scatter the face normals in face order. On a single thread this is faster than the gather
+		// below and it produces exactly the same sums.
+		for ( unsigned int i=0; i<nvn; i++ ) vn[i].Set(0,0,0);	// initialize all normals to zero
+		for ( unsigned int i=0; i<nf; i++ ) {
+			Point3f N = FaceNormal(i);
+			for ( unsigned int k=0; k<3; k++ ) vn[ f[i].v[k] ] += weighting == NORMAL_WEIGHT_ANGLE ? N * CornerAngle(i,k) : N;
+			fn[i] = f[i];
+		}
+		for ( unsigned int i=0; i<nvn; i++ ) vn[i].Normalize();
+		return;
+	}
+
+	// Compute the face normals and the corner angles
+	std::vector<Point3f> faceNormals(nf);
+	std::vector<float>   cornerAngles( weighting == NORMAL_WEIGHT_ANGLE ? size_t(nf)*3 : 0 );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		faceNormals[i] = FaceNormal(i);
+		if ( weighting == NORMAL_WEIGHT_ANGLE ) for ( unsigned int k=0; k<3; k++ ) cornerAngles[ size_t(i)*3 + k ] = CornerAngle(i,k);
 		fn[i] = f[i];
+	} );
+
+	// Find the face corners of each vertex, sorted in face order (compressed sparse rows)
+	std::unique_ptr<std::atomic<unsigned int>[]> cornerCount( new std::atomic<unsigned int>[nv] );
+	ParallelFor( 0u, nv, [&]( unsigned int i ) { cornerCount[i].store( 0, std::memory_order_relaxed ); } );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		for ( int k=0; k<3; k++ ) cornerCount[ f[i].v[k] ].fetch_add( 1, std::memory_order_relaxed );
+	} );
+	std::vector<unsigned int> cornerStart(nv+1);
+	cornerStart[0] = 0;
+	for ( unsigned int i=0; i<nv; i++ ) {
+		cornerStart[i+1] = cornerStart[i] + cornerCount[i].load( std::memory_order_relaxed );
+		cornerCount[i].store( cornerStart[i], std::memory_order_relaxed );
 	}
-	for ( unsigned int i=0; i<nvn; i++ ) vn[i].Normalize();
+	std::vector<unsigned int> corners( cornerStart[nv] );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		for ( unsigned int k=0; k<3; k++ ) corners[ cornerCount[ f[i].v[k] ].fetch_add( 1, std::memory_order_relaxed ) ] = i*3 + k;
+	} );
+
+	// Sum the face normals of each vertex in face order
+	ParallelFor( 0u, nv, [&]( unsigned int i ) {
+		unsigned int *c = corners.data() + cornerStart[i];
+		unsigned int n = cornerStart[i+1] - cornerStart[i];
+		// The corners of a vertex are usually few, so insertion sort is used,
+		// except for high-valence vertices, such as the apex of a fan, for which it would be quadratic.
+		if ( n > 32 ) std::sort( c, c+n );
+		else for ( unsigned int j=1; j<n; j++ ) {
+			unsigned int cj = c[j], k = j;
+			for ( ; k>0 && c[k-1] > cj; k-- ) c[k] = c[k-1];
+			c[k] = cj;
+		}
+		Point3f N(0,0,0);
+		for ( unsigned int j=0; j<n; j++ ) N += weighting == NORMAL_WEIGHT_ANGLE ? faceNormals[ c[j]/3 ] * cornerAngles[ c[j] ] : faceNormals[ c[j]/3 ];
+		N.Normalize();
+		vn[i] = N;
+	} );
 }
 
-inline bool TriMesh::LoadFromFileObj( const char *filename, bool loadMtl )
+inline float TriMesh::ComputeACMR(int cacheSize) const
 {
-	FILE *fp = fopen(filename,"r");
-	if ( !fp ) return false;
+	if ( nf == 0 ) return 0;
+	std::vector<unsigned int> cache( cacheSize, 0xFFFFFFFF );
+	size_t misses = 0;
+	int next = 0;
+	for ( unsigned int i=0; i<nf; i++ ) {
+		for ( int k=0; k<3; k++ ) {
+			unsigned int vi = f[i].v[k];
+			bool found = false;
+			for ( int c=0; c<cacheSize; c++ ) if ( cache[c] == vi ) { found = true; break; }
+			if ( found ) continue;
+			misses++;
+			cache[next] = vi;
+			next = ( next + 1 ) % cacheSize;
+		}
+	}
+	return float(misses) / float(nf);
+}
 
-	Clear();
+inline void TriMesh::OptimizeFaceOrder(int cacheSize)
+{
+	if ( nf == 0 ) return;
+	if ( cacheSize < 4 ) cacheSize = 4;
+	std::vector<unsigned int> localID( nv, 0xFFFFFFFF );
+	std::vector<unsigned int> order;
+	std::vector<TriFace> temp;
+	// Each material has a separate face range, followed by the faces without a material
+	for ( unsigned int r=0; r<=nm; r++ ) {
+		unsigned int faceBegin = r > 0 ? (unsigned int) mcfc[r-1] : 0;
+		unsigned int faceEnd   = r < nm ? (unsigned int) mcfc[r]   : nf;
+		if ( faceEnd > nf ) faceEnd = nf;
+		if ( faceEnd <= faceBegin + 1 ) continue;
+		OptimizeFaceRange( faceBegin, faceEnd, cacheSize, f, localID, order );
+		TriFace *faceArrays[3] = { f, fn, ft };
+		for ( int a=0; a<3; a++ ) {
+			TriFace *faces = faceArrays[a];
+			if ( ! faces ) continue;
+			temp.assign( faces + faceBegin, faces + faceEnd );
+			for ( size_t i=0; i<order.size(); i++ ) faces[ faceBegin + i ] = temp[ order[i] ];
+		}
+	}
+}
 
-	class Buffer
-	{
-		char data[1024];
-		int readLine;
-	public:
-		int ReadLine(FILE *fp)
-		{
-			char c = fgetc(fp);
-			while ( !feof(fp) ) {
-				while ( isspace(c) && ( !feof(fp) || c!='\0' ) ) c = fgetc(fp);	// skip empty space
-				if ( c == '#' ) while ( !feof(fp) && c!='\n' && c!='\r' && c!='\0' ) c = fgetc(fp);	// skip comment line
-				else break;
-			}
-			int i=0;
-			bool inspace = false;
-			while ( i<1024-1 ) {
-				if ( feof(fp) || c=='\n' || c=='\r' || c=='\0' ) break;
-				if ( isspace(c) ) {	// only use a single space as the space character
-					inspace = true;
-				} else {
-					if ( inspace ) data[i++] = ' ';
-					inspace = false;
-					data[i++] = c;
-				}
-				c = fgetc(fp);
-			}
-			data[i] = '\0';
-			readLine = i;
-			return i;
-		}
-		char& operator[](int i) { return data[i]; }
-		void ReadVertex( Point3f &v ) const { sscanf( data+2, "%f %f %f", &v.x, &v.y, &v.z ); }
-		void ReadFloat3( float f[3] ) const { sscanf( data+2, "%f %f %f", &f[0], &f[1], &f[2] ); }
-		void ReadFloat( float *f ) const { sscanf( data+2, "%f", f ); }
-		void ReadInt( int *i, int start ) const { sscanf( data+start, "%d", i ); }
-		bool IsCommand( const char *cmd ) const {
-			int i=0;
-			while ( cmd[i]!='\0' ) {
-				if ( cmd[i] != data[i] ) return false;
-				i++;
-			}
-			return (data[i]=='\0' || data[i]==' ');
+inline void TriMesh::OptimizeFaceRange( unsigned int faceBegin, unsigned int faceEnd, int cacheSize, const TriFace *faces, std::vector<unsigned int> &localID, std::vector<unsigned int> &order )
+{
+	const unsigned int nt = faceEnd - faceBegin;
+	const TriFace *tris = faces + faceBegin;
+	const unsigned int NONE = 0xFFFFFFFF;
+
+	// Assign local indices to the vertices of the range
+	std::vector<unsigned int> verts;
+	std::vector<unsigned int> triVerts( size_t(nt)*3 );
+	for ( unsigned int t=0; t<nt; t++ ) {
+		for ( int k=0; k<3; k++ ) {
+			unsigned int &id = localID[ tris[t].v[k] ];
+			if ( id == NONE ) { id = (unsigned int) verts.size(); verts.push_back( tris[t].v[k] ); }
+			triVerts[ t*3 + k ] = id;
 		}
-		void Copy( char *a, int count, int start=0 ) const {
-			strncpy( a, data+start, count-1 );
-			a[count-1] = '\0';
+	}
+	const unsigned int lv = (unsigned int) verts.size();
+	for ( unsigned int i=0; i<lv; i++ ) localID[ verts[i] ] = NONE;
+
+	// Find the triangles of each vertex. The active triangles of vertex i are kept
+	// at the beginning of its list and their count is valence[i].
+	std::vector<unsigned int> valence( lv, 0 );
+	for ( size_t i=0; i<triVerts.size(); i++ ) valence[ triVerts[i] ]++;
+	std::vector<unsigned int> triStart( lv+1 );
+	triStart[0] = 0;
+	for ( unsigned int i=0; i<lv; i++ ) triStart[i+1] = triStart[i] + valence[i];
+	std::vector<unsigned int> triList( triStart[lv] );
+	std::vector<unsigned int> fill( triStart.begin(), triStart.end()-1 );
+	for ( unsigned int t=0; t<nt; t++ ) for ( int k=0; k<3; k++ ) triList[ fill[ triVerts[t*3+k] ]++ ] = t;
+
+	// The vertex score favors the vertices in the cache (especially the most recent triangle)
+	// and the vertices with few remaining triangles.
+	auto VertexScore = [cacheSize]( int cachePos, unsigned int remaining ) {
+		if ( remaining == 0 ) return -1.0f;
+		float score = 0;
+		if ( cachePos >= 0 ) {
+			if ( cachePos < 3 ) score = 0.75f;
+			else score = powf( 1.0f - float(cachePos-3) / float(cacheSize-3), 1.5f );
 		}
+		return score + 2.0f / sqrtf( float(remaining) );
 	};
-	Buffer buffer;
 
+	std::vector<int>   cachePos( lv, -1 );
+	std::vector<float> vertScore( lv );
+	for ( unsigned int i=0; i<lv; i++ ) vertScore[i] = VertexScore( -1, valence[i] );
+	auto TriScore = [&]( unsigned int t ) { return vertScore[triVerts[t*3]] + vertScore[triVerts[t*3+1]] + vertScore[triVerts[t*3+2]]; };
+	std::vector<char> added( nt, 0 );
+	unsigned int bestTri = 0;
+	float bestScore = TriScore(0);
+	for ( unsigned int t=1; t<nt; t++ ) {
+		float score = TriScore(t);
+		if ( score > bestScore ) { bestScore = score; bestTri = t; }
+	}
 
-	struct MtlData
-	{
-		char mtlName[256];
-		unsigned int firstFace;
-		unsigned int faceCount;
-		MtlData() { mtlName[0]='\0'; faceCount=0; firstFace=0; }
-	};
-	struct MtlList {
-		std::vector<MtlData> mtlData;
-		int GetMtlIndex(const char *mtlName)
-		{
-			for ( unsigned int i=0; i<mtlData.size(); i++ ) {
-				if ( strcmp(mtlName,mtlData[i].mtlName) == 0 ) return (int)i;
-			}
-			return -1;
+	std::vector<unsigned int> cache, newCache;
+	cache.reserve( cacheSize+3 );
+	newCache.reserve( cacheSize+3 );
+	order.resize( nt );
+	unsigned int cursor = 0;
+	for ( unsigned int n=0; n<nt; n++ ) {
+		if ( bestTri == NONE ) {
+			// No triangle in the cache has remaining triangles, continue with the next triangle in the original order
+			while ( added[cursor] ) cursor++;
+			bestTri = cursor;
 		}
-		int CreateMtl(const char *mtlName, unsigned int firstFace)
-		{
-			if ( mtlName[0] == '\0' ) return NULL;
-			int i = GetMtlIndex(mtlName);
-			if ( i >= 0 ) return i;
-			MtlData m;
-			strncpy(m.mtlName,mtlName,256);
-			m.firstFace = firstFace;
-			mtlData.push_back(m);
-			return (int)mtlData.size()-1;
+		order[n] = bestTri;
+		added[bestTri] = 1;
+
+		// Remove the triangle from the lists of its vertices and add the vertices to the front of the cache
+		newCache.clear();
+		for ( int k=0; k<3; k++ ) {
+			unsigned int vi = triVerts[ bestTri*3 + k ];
+			unsigned int *list = triList.data() + triStart[vi];
+			unsigned int j = 0;
+			while ( list[j] != bestTri ) j++;
+			list[j] = list[ --valence[vi] ];
+			list[ valence[vi] ] = bestTri;
+			newCache.push_back( vi );
 		}
-	};
-	MtlList mtlList;
-	MtlData *currentMtlData = NULL;
-	struct MtlLibName { char filename[1024]; };
-	std::vector<Point3f>	_v;		// vertices
-	std::vector<TriFace>	_f;		// faces
-	std::vector<Point3f>	_vn;	// vertex normal
-	std::vector<TriFace>	_fn;	// normal faces
-	std::vector<Point3f>	_vt;	// texture vertices
-	std::vector<TriFace>	_ft;	// texture faces
-	std::vector<MtlLibName> mtlFiles;
-	std::vector<int> faceMtlIndex;
-
-	int currentMtlIndex = -1;
-	bool hasTextures=false, hasNormals=false;
-
-	while ( int rb = buffer.ReadLine(fp) ) {
-		if ( buffer.IsCommand("v") ) {
-			Point3f vertex;
-			buffer.ReadVertex(vertex);
-			_v.push_back(vertex);
-		}
-		else if ( buffer.IsCommand("vt") ) {
-			Point3f texVert;
-			buffer.ReadVertex(texVert);
-			_vt.push_back(texVert);
-			hasTextures = true;
-		}
-		else if ( buffer.IsCommand("vn") ) {
-			Point3f normal;
-			buffer.ReadVertex(normal);
-			_vn.push_back(normal);
-			hasNormals = true;
-		}
-		else if ( buffer.IsCommand("f") ) {
-			int facevert = -1;
-			bool inspace = true;
-			int type = 0;
-			unsigned int index;
-			TriFace face, textureFace, normalFace;
-			unsigned int nFacesBefore = _f.size();
-			for ( int i=2; i<rb; i++ ) {
-				if ( buffer[i] == ' ' ) inspace = true;
-				else {
-					if ( inspace ) {
-						inspace=false;
-						type=0;
-						index=0;
-						switch ( facevert ) {
-							case -1:
-								// initialize face
-								face.v[0] = face.v[1] = face.v[2] = 0;
-								textureFace.v[0] = textureFace.v[1] = textureFace.v[2] = 0;
-								normalFace.v[0] = normalFace.v[1] = normalFace.v[2] = 0;
-							case 0:
-							case 1:
-								facevert++;
-								break;
-							case 2:
-								// copy the first two vertices from the previous face
-								_f.push_back(face);
-								face.v[1] = face.v[2];
-								if ( hasTextures ) {
-									_ft.push_back(textureFace);
-									textureFace.v[1] = textureFace.v[2];
-								}
-								if ( hasNormals ) {
-									_fn.push_back(normalFace);
-									normalFace.v[1] = normalFace.v[2];
-								}
-								faceMtlIndex.push_back(currentMtlIndex);
-								break;
-						}
-					}
-					if ( buffer[i] == '/' ) { type++; index=0; }
-					if ( buffer[i] >= '0' && buffer[i] <= '9' ) {
-						index = index*10 + (buffer[i]-'0');
-						switch ( type ) {
-							case 0: face.v[facevert] = index-1; break;
-							case 1: textureFace.v[facevert] = index-1; hasTextures=true; break;
-							case 2: normalFace.v[facevert] = index-1; hasNormals=true; break;
-						}
-					}
-				}
-			}
-			_f.push_back(face);
-			if ( hasTextures ) _ft.push_back(textureFace);
-			if ( hasNormals  ) _fn.push_back(normalFace);
-			faceMtlIndex.push_back(currentMtlIndex);
-			if ( currentMtlIndex>=0 ) mtlList.mtlData[currentMtlIndex].faceCount += _f.size() - nFacesBefore;
-		}
-		else if ( loadMtl ) {
-			if ( buffer.IsCommand("usemtl") ) {
-				char mtlName[256];
-				buffer.Copy(mtlName,256,7);
-				currentMtlIndex = mtlList.CreateMtl(mtlName, _f.size());
-			}
-			if ( buffer.IsCommand("mtllib") ) {
-				MtlLibName libName;
-				buffer.Copy(libName.filename,1024,7);
-				mtlFiles.push_back(libName);
+		for ( size_t i=0; i<cache.size(); i++ ) {
+			unsigned int vi = cache[i];
+			if ( vi != newCache[0] && vi != newCache[1] && vi != newCache[2] ) newCache.push_back( vi );
+		}
+		cache.swap( newCache );
+
+		// Update the scores of the vertices in the cache and their triangles
+		for ( size_t i=0; i<cache.size(); i++ ) {
+			unsigned int vi = cache[i];
+			cachePos[vi] = i < size_t(cacheSize) ? int(i) : -1;
+			vertScore[vi] = VertexScore( cachePos[vi], valence[vi] );
+		}
+		bestTri = NONE;
+		bestScore = -1;
+		for ( size_t i=0; i<cache.size(); i++ ) {
+			unsigned int vi = cache[i];
+			const unsigned int *list = triList.data() + triStart[vi];
+			for ( unsigned int j=0; j<valence[vi]; j++ ) {
+				float score = TriScore( list[j] );
+				if ( score > bestScore ) { bestScore = score; bestTri = list[j]; }
 			}
 		}
-		if ( feof(fp) ) break;
+		if ( cache.size() > size_t(cacheSize) ) cache.resize( cacheSize );
 	}
+}
 
-	fclose(fp);
+inline void TriMesh::OptimizeVertexOrder()
+{
+	ReorderVertices( v, nv, f, nf );
+	if ( vt && ft ) ReorderVertices( vt, nvt, ft, nf );
+	if ( vn && fn ) ReorderVertices( vn, nvn, fn, nf );
+}
+
+inline void TriMesh::ReorderVertices( Point3f *verts, unsigned int numVerts, TriFace *faces, unsigned int numFaces )
+{
+	const unsigned int NONE = 0xFFFFFFFF;
+	std::vector<unsigned int> newID( numVerts, NONE );
+	unsigned int n = 0;
+	for ( unsigned int i=0; i<numFaces; i++ ) {
+		for ( int k=0; k<3; k++ ) {
+			unsigned int &id = newID[ faces[i].v[k] ];
+			if ( id == NONE ) id = n++;
+			faces[i].v[k] = id;
+		}
+	}
+	for ( unsigned int i=0; i<numVerts; i++ ) if ( newID[i] == NONE ) newID[i] = n++;
+	std::vector<Point3f> temp( verts, verts + numVerts );
+	for ( unsigned int i=0; i<numVerts; i++ ) verts[ newID[i] ] = temp[i];
+}
+
+inline void TriMesh::SpatialSortVertices(SpaceFillingCurve curve)
+{
+	if ( nv == 0 ) return;
+	std::vector<unsigned int> order( nv ), newIndex( nv );
+	SpatialSortOrder( v, nv, order.data(), curve );
+	InvertOrder( order.data(), nv, newIndex.data() );
+	const bool sortTexVerts = vt && ft && nvt == nv && memcmp( ft, f, sizeof(TriFace)*nf ) == 0;
+	const bool sortNormals  = vn && fn && nvn == nv && memcmp( fn, f, sizeof(TriFace)*nf ) == 0;
+	ApplyOrder( v, nv, order.data() );
+	if ( sortTexVerts ) ApplyOrder( vt, nvt, order.data() );
+	if ( sortNormals  ) ApplyOrder( vn, nvn, order.data() );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		for ( int k=0; k<3; k++ ) f[i].v[k] = newIndex[ f[i].v[k] ];
+		if ( sortTexVerts ) ft[i] = f[i];
+		if ( sortNormals  ) fn[i] = f[i];
+	} );
+}
+
+inline void TriMesh::SpatialSortFaces(SpaceFillingCurve curve)
+{
+	if ( nf == 0 ) return;
+	Point3f bmin, bmax;
+	ComputeBounds( v, nv, bmin, bmax );
+	std::vector<Point3f> centers( nf );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) { centers[i] = ( v[f[i].v[0]] + v[f[i].v[1]] + v[f[i].v[2]] ) / 3.0f; } );
+	// Each material has a separate face range, followed by the faces without a material
+	std::vector<unsigned int> order( nf );
+	for ( unsigned int r=0; r<=nm; r++ ) {
+		unsigned int faceBegin = r > 0 ? (unsigned int) mcfc[r-1] : 0;
+		unsigned int faceEnd   = r < nm ? (unsigned int) mcfc[r]   : nf;
+		if ( faceEnd > nf ) faceEnd = nf;
+		if ( faceEnd <= faceBegin ) continue;
+		unsigned int *rangeOrder = order.data() + faceBegin;
+		SpatialSortOrder( centers.data() + faceBegin, faceEnd - faceBegin, rangeOrder, curve, bmin, bmax );
+		for ( unsigned int i=0; i<faceEnd-faceBegin; i++ ) rangeOrder[i] += faceBegin;
+	}
+	ApplyOrder( f, nf, order.data() );
+	if ( fn ) ApplyOrder( fn, nf, order.data() );
+	if ( ft ) ApplyOrder( ft, nf, order.data() );
+}
+
+inline void TriMesh::WeldVertices(float tolerance, bool weldTexVerts, bool weldNormals)
+{
+	WeldArray( v, nv, f, tolerance );
+	if ( weldTexVerts && vt && ft ) WeldArray( vt, nvt, ft, 0 );
+	if ( weldNormals  && vn && fn ) WeldArray( vn, nvn, fn, 0 );
+}
+
+inline void TriMesh::WeldArray( Point3f* &verts, unsigned int &numVerts, TriFace *faces, float tolerance )
+{
+	if ( numVerts == 0 ) return;
+	std::vector<unsigned int> remap( numVerts );
+	unsigned int n = WeldPoints( verts, numVerts, tolerance, remap.data() );
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		for ( int k=0; k<3; k++ ) faces[i].v[k] = remap[ faces[i].v[k] ];
+	} );
+	if ( n == numVerts ) return;
+	// Keep the first vertex of each merged group
+	std::vector<Point3f> welded( n );
+	for ( unsigned int i=numVerts; i-->0; ) welded[ remap[i] ] = verts[i];
+	Allocate( n, verts, numVerts );
+	std::copy( welded.begin(), welded.end(), verts );
+}
+
+inline void TriMesh::DeleteFaces( const bool *deleteFace )
+{
+	unsigned int n = 0, mtl = 0;
+	for ( unsigned int i=0; i<nf; i++ ) {
+		for ( ; mtl<nm && mcfc[mtl]<=int(i); mtl++ ) mcfc[mtl] = int(n);	// the end of the material after deleting its faces
+		if ( deleteFace[i] ) continue;
+		f[n] = f[i];
+		if ( fn ) fn[n] = fn[i];
+		if ( ft ) ft[n] = ft[i];
+		n++;
+	}
+	for ( ; mtl<nm; mtl++ ) mcfc[mtl] = int(n);
+	if ( n == nf ) return;
+	Reallocate( n, f );
+	if ( fn ) Reallocate( n, fn );
+	if ( ft ) Reallocate( n, ft );
+	nf = n;
+}
 
+inline void TriMesh::DeleteUnusedVertices()
+{
+	DeleteUnusedArray( v, nv, f );
+	if ( vt && ft ) DeleteUnusedArray( vt, nvt, ft );
+	if ( vn && fn ) DeleteUnusedArray( vn, nvn, fn );
+}
+
+inline void TriMesh::DeleteUnusedArray( Point3f* &verts, unsigned int &numVerts, TriFace *faces )
+{
+	if ( numVerts == 0 ) return;
+	std::vector<unsigned int> remap( numVerts, 0 );
+	for ( unsigned int i=0; i<nf; i++ ) {
+		for ( int k=0; k<3; k++ ) remap[ faces[i].v[k] ] = 1;
+	}
+	unsigned int n = 0;
+	for ( unsigned int i=0; i<numVerts; i++ ) {
+		if ( ! remap[i] ) continue;
+		verts[n] = verts[i];
+		remap[i] = n++;
+	}
+	if ( n == numVerts ) return;
+	ParallelFor( 0u, nf, [&]( unsigned int i ) {
+		for ( int k=0; k<3; k++ ) faces[i].v[k] = remap[ faces[i].v[k] ];
+	} );
+	Reallocate( n, verts );
+	numVerts = n;
+}
+
+inline bool TriMesh::LoadFromFileObj( const char *filename, bool loadMtl, bool useCache )
+{
+	if ( useCache ) {
+		int64_t time;
+		uint64_t size;
+		if ( ! MappedFile::GetFileInfo( filename, time, size ) ) return false;
+		std::vector<char> cacheFilename( filename, filename + strlen(filename) );
+		const char ext[] = ".cymesh";
+		cacheFilename.insert( cacheFilename.end(), ext, ext + sizeof(ext) );
+		if ( LoadBinary( cacheFilename.data(), true, &time, size, loadMtl ) ) return true;
+		if ( ! LoadFromFileObj( filename, loadMtl, false ) ) return false;
+		SaveBinary( cacheFilename.data(), time, size, loadMtl );	// failing to write the cache is not an error
+		return true;
+	}
+
+	std::vector<char> data;
+	if ( ! ReadFile( filename, data ) ) return false;
+
+	Clear();
+
+	// Split the file into blocks at line boundaries and count the items in each block in parallel
+	std::vector<ObjBlock> blocks;
+	ObjSplitBlocks( data, blocks );
+	int blockCount = (int) blocks.size();
+	ParallelForRanges( 0, blockCount, blockCount, [&]( int, int blockBegin, int blockEnd ) {
+		for ( int b=blockBegin; b<blockEnd; b++ ) ObjCountBlock( blocks[b], loadMtl );
+	} );
+
+	// Compute the number of items before each block
+	unsigned int numV=0, numVT=0, numVN=0, numF=0;
+	for ( size_t b=0; b<blocks.size(); b++ ) {
+		ObjBlock &block = blocks[b];
+		block.v0  = numV;
+		block.vt0 = numVT;
+		block.vn0 = numVN;
+		numV  += block.nv;
+		numVT += block.nvt;
+		numVN += block.nvn;
+		numF  += block.nf;
+	}
+	if ( numF == 0 ) return true; // No faces found
 
-	if ( _f.size() == 0 ) return true; // No faces found
-	SetNumVertex(_v.size());
-	SetNumFaces(_f.size());
-	SetNumTexVerts(_vt.size());
-	SetNumNormals(_vn.size());
-	if ( loadMtl ) SetNumMtls(mtlList.mtlData.size());
-
-	// Copy data
-	memcpy(v, _v.data(), sizeof(Point3f)*_v.size());
-	if ( _vt.size() > 0 ) memcpy(vt, _vt.data(), sizeof(Point3f)*_vt.size());
-	if ( _vn.size() > 0 ) memcpy(vn, _vn.data(), sizeof(Point3f)*_vn.size());
-
-	if ( mtlList.mtlData.size() > 0 ) {
-		unsigned int fid = 0;
-		for ( int m=0; m<(int)mtlList.mtlData.size(); m++ ) {
-			for ( unsigned int i=mtlList.mtlData[m].firstFace, j=0; j<mtlList.mtlData[m].faceCount && i<_f.size(); i++ ) {
-				if ( faceMtlIndex[i] == m ) {
-					f[fid] = _f[i];
-					if ( fn ) fn[fid] = _fn[i];
-					if ( ft ) ft[fid] = _ft[i];
-					fid++;
+	// Find the materials and place the faces of each material consecutively, followed by the faces without a material
+	std::vector<ObjName> mtlNames;
+	std::vector<unsigned int> mtlFirstFace;
+	int currentMtl = -1;
+	for ( size_t b=0; b<blocks.size(); b++ ) {
+		std::vector<ObjRun> &runs = blocks[b].runs;
+		for ( size_t r=0; r<runs.size(); r++ ) {
+			if ( runs[r].mtl.str ) {
+				currentMtl = -1;
+				if ( runs[r].mtl.len > 0 ) {
+					for ( size_t i=0; i<mtlNames.size(); i++ ) {
+						if ( mtlNames[i].len == runs[r].mtl.len && memcmp( mtlNames[i].str, runs[r].mtl.str, runs[r].mtl.len ) == 0 ) { currentMtl = (int)i; break; }
+					}
+					if ( currentMtl < 0 ) {
+						currentMtl = (int) mtlNames.size();
+						mtlNames.push_back( runs[r].mtl );
+						mtlFirstFace.push_back( 0 );
+					}
 				}
 			}
+			runs[r].mtlID = currentMtl;
+			if ( currentMtl >= 0 ) mtlFirstFace[currentMtl] += runs[r].faceCount;
 		}
-		if ( fid <_f.size() ) {
-			for ( unsigned int i=0; i<_f.size(); i++ ) {
-				if ( faceMtlIndex[i] < 0 ) {
-					f[fid] = _f[i];
-					if ( fn ) fn[fid] = _fn[i];
-					if ( ft ) ft[fid] = _ft[i];
-					fid++;
-				}
-			}
+	}
+	unsigned int noMtlFirstFace = 0;
+	for ( size_t i=0; i<mtlFirstFace.size(); i++ ) {
+		unsigned int n = mtlFirstFace[i];
+		mtlFirstFace[i] = noMtlFirstFace;
+		noMtlFirstFace += n;
+	}
+	for ( size_t b=0; b<blocks.size(); b++ ) {
+		std::vector<ObjRun> &runs = blocks[b].runs;
+		for ( size_t r=0; r<runs.size(); r++ ) {
+			unsigned int &firstFace = runs[r].mtlID >= 0 ? mtlFirstFace[ runs[r].mtlID ] : noMtlFirstFace;
+			runs[r].firstFace = firstFace;
+			firstFace += runs[r].faceCount;
+		}
+	}
+
+	// Allocate the mesh data
+	SetNumVertex(numV);
+	SetNumFaces(numF);
+	SetNumTexVerts(numVT);
+	SetNumNormals(numVN);
+	if ( loadMtl ) {
+		SetNumMtls( (unsigned int) mtlNames.size() );
+		for ( unsigned int i=0; i<nm; i++ ) {
+			unsigned int n = mtlNames[i].len < 255 ? mtlNames[i].len : 255;
+			memcpy( m[i].name, mtlNames[i].str, n );
+			m[i].name[n] = '\0';
+			mcfc[i] = (int) mtlFirstFace[i];	// after placing the runs, this is the end of the material's faces
 		}
-	} else {
-		memcpy(f, _f.data(), sizeof(TriFace)*_f.size());
-		if ( ft ) memcpy(ft, _ft.data(), sizeof(TriFace)*_ft.size());
-		if ( fn ) memcpy(fn, _fn.data(), sizeof(TriFace)*_fn.size());
 	}
 
+	// Parse the blocks in parallel directly into the mesh data
+	ParallelForRanges( 0, blockCount, blockCount, [&]( int, int blockBegin, int blockEnd ) {
+		for ( int b=blockBegin; b<blockEnd; b++ ) ObjParseBlock( blocks[b], loadMtl );
+	} );
 
 	// Load the .mtl files
 	if ( loadMtl ) {
+		class Buffer
+		{
+			char data[1024];
+			int readLine;
+		public:
+			int ReadLine(FILE *fp)
+			{
+				char c = fgetc(fp);
+				while ( !feof(fp) ) {
+					while ( isspace(c) && ( !feof(fp) || c!='\0' ) ) c = fgetc(fp);	// skip empty space
+					if ( c == '#' ) while ( !feof(fp) && c!='\n' && c!='\r' && c!='\0' ) c = fgetc(fp);	// skip comment line
+					else break;
+				}
+				int i=0;
+				bool inspace = false;
+				while ( i<1024-1 ) {
+					if ( feof(fp) || c=='\n' || c=='\r' || c=='\0' ) break;
+					if ( isspace(c) ) {	// only use a single space as the space character
+						inspace = true;
+					} else {
+						if ( inspace ) data[i++] = ' ';
+						inspace = false;
+						data[i++] = c;
+					}
+					c = fgetc(fp);
+				}
+				data[i] = '\0';
+				readLine = i;
+				return i;
+			}
+			char& operator[](int i) { return data[i]; }
+			void ReadFloat3( float f[3] ) const { sscanf( data+2, "%f %f %f", &f[0], &f[1], &f[2] ); }
+			void ReadFloat( float *f ) const { sscanf( data+2, "%f", f ); }
+			void ReadInt( int *i, int start ) const { sscanf( data+start, "%d", i ); }
+			bool IsCommand( const char *cmd ) const {
+				int i=0;
+				while ( cmd[i]!='\0' ) {
+					if ( cmd[i] != data[i] ) return false;
+					i++;
+				}
+				return (data[i]=='\0' || data[i]==' ');
+			}
+			void Copy( char *a, int count, int start=0 ) const {
+				strncpy( a, data+start, count-1 );
+				a[count-1] = '\0';
+			}
+		};
+		Buffer buffer;
+
 		// get the path from filename
 		char *mtlFullFilename = NULL;
 		char *mtlFilename = NULL;
@@ -467,31 +910,38 @@ inline bool TriMesh::LoadFromFileObj( const char *filename, bool loadMtl )
 			mtlFullFilename = new char[1024];
 			mtlFilename = mtlFullFilename;
 		}
-		for ( unsigned int mi=0; mi<mtlFiles.size(); mi++ ) {
-			strncpy( mtlFilename, mtlFiles[mi].filename, 1024 );
-			FILE *fp = fopen(mtlFullFilename,"r");
-			if ( !fp ) continue;
-			int mtlID = -1;
-			while ( int rb = buffer.ReadLine(fp) ) {
-				if ( buffer.IsCommand("newmtl") ) {
-					char mtlName[256];
-					buffer.Copy(mtlName,256,7);
-					mtlID = mtlList.GetMtlIndex(mtlName);
-					if ( mtlID >= 0 ) strncpy(m[mtlID].name,mtlName,256);
-				} else if ( mtlID >= 0 ) {
-					if ( buffer.IsCommand("Ka") ) buffer.ReadFloat3( m[mtlID].Ka );
-					else if ( buffer.IsCommand("Kd") ) buffer.ReadFloat3( m[mtlID].Kd );
-					else if ( buffer.IsCommand("Ks") ) buffer.ReadFloat3( m[mtlID].Ks );
-					else if ( buffer.IsCommand("Tf") ) buffer.ReadFloat3( m[mtlID].Tf );
-					else if ( buffer.IsCommand("Ns") ) buffer.ReadFloat( &m[mtlID].Ns );
-					else if ( buffer.IsCommand("Ni") ) buffer.ReadFloat( &m[mtlID].Ni );
-					else if ( buffer.IsCommand("illum") ) buffer.ReadInt( &m[mtlID].illum, 5 );
-					else if ( buffer.IsCommand("map_Ka") ) buffer.Copy( m[mtlID].map_Ka.name, 256, 7 );
-					else if ( buffer.IsCommand("map_Kd") ) buffer.Copy( m[mtlID].map_Kd.name, 256, 7 );
-					else if ( buffer.IsCommand("map_Ks") ) buffer.Copy( m[mtlID].map_Ks.name, 256, 7 );
+		for ( size_t b=0; b<blocks.size(); b++ ) {
+			for ( size_t mi=0; mi<blocks[b].mtlLibs.size(); mi++ ) {
+				const ObjName &libName = blocks[b].mtlLibs[mi];
+				unsigned int n = libName.len < 1023 ? libName.len : 1023;
+				memcpy( mtlFilename, libName.str, n );
+				mtlFilename[n] = '\0';
+				FILE *fp = fopen(mtlFullFilename,"r");
+				if ( !fp ) continue;
+				int mtlID = -1;
+				while ( buffer.ReadLine(fp) ) {
+					if ( buffer.IsCommand("newmtl") ) {
+						char mtlName[256];
+						buffer.Copy(mtlName,256,7);
+						mtlID = -1;
+						for ( unsigned int i=0; i<nm; i++ ) {
+							if ( strcmp(mtlName,m[i].name) == 0 ) { mtlID = (int)i; break; }
+						}
+					} else if ( mtlID >= 0 ) {
+						if ( buffer.IsCommand("Ka") ) buffer.ReadFloat3( m[mtlID].Ka );
+						else if ( buffer.IsCommand("Kd") ) buffer.ReadFloat3( m[mtlID].Kd );
+						else if ( buffer.IsCommand("Ks") ) buffer.ReadFloat3( m[mtlID].Ks );
+						else if ( buffer.IsCommand("Tf") ) buffer.ReadFloat3( m[mtlID].Tf );
+						else if ( buffer.IsCommand("Ns") ) buffer.ReadFloat( &m[mtlID].Ns );
+						else if ( buffer.IsCommand("Ni") ) buffer.ReadFloat( &m[mtlID].Ni );
+						else if ( buffer.IsCommand("illum") ) buffer.ReadInt( &m[mtlID].illum, 5 );
+						else if ( buffer.IsCommand("map_Ka") ) buffer.Copy( m[mtlID].map_Ka.name, 256, 7 );
+						else if ( buffer.IsCommand("map_Kd") ) buffer.Copy( m[mtlID].map_Kd.name, 256, 7 );
+						else if ( buffer.IsCommand("map_Ks") ) buffer.Copy( m[mtlID].map_Ks.name, 256, 7 );
+					}
 				}
+				fclose(fp);
 			}
-			fclose(fp);
 		}
 		delete [] mtlFullFilename;
 	}
@@ -501,46 +951,627 @@ inline bool TriMesh::LoadFromFileObj( const char *filename, bool loadMtl )
 
 //-------------------------------------------------------------------------------
 
-inline bool TriMesh::SaveToFileObj( const char *filename )
+inline bool TriMesh::ReadFile( const char *filename, std::vector<char> &data )
 {
-	FILE *fp = fopen(filename,"w");
+	FILE *fp = fopen(filename,"rb");
 	if ( !fp ) return false;
 
-	for ( unsigned int i=0; i<nv; i++ ) {
-		fprintf(fp,"v %f %f %f\n",v[i].x, v[i].y, v[i].z);
+	// Read the whole file with large block reads. The file size is only used as a hint,
+	// so that files that are larger than what ftell can report are also read completely.
+	size_t size = 0;
+	if ( fseek(fp,0,SEEK_END) == 0 ) {
+		long s = ftell(fp);
+		if ( s > 0 ) size = (size_t) s;
+		fseek(fp,0,SEEK_SET);
 	}
-	for ( unsigned int i=0; i<nvt; i++ ) {
-		fprintf(fp,"vt %f %f %f\n",vt[i].x, vt[i].y, vt[i].z);
+	const size_t blockSize = 1 << 24;
+	size_t n = 0;
+	data.resize( size > 0 ? size + 1 : blockSize );
+	for (;;) {
+		size_t r = fread( data.data()+n, 1, data.size()-n, fp );
+		n += r;
+		if ( n < data.size() ) break;
+		data.resize( data.size() + blockSize );
 	}
-	for ( unsigned int i=0; i<nvn; i++ ) {
-		fprintf(fp,"vn %f %f %f\n",vn[i].x, vn[i].y, vn[i].z);
+	fclose(fp);
+	data.resize( n + 1 );
+	data[n] = '\0';	// the parser relies on the terminating zero
+	return true;
+}
+
+inline void TriMesh::ObjSplitBlocks( const std::vector<char> &data, std::vector<ObjBlock> &blocks )
+{
+	// Use multiple blocks per thread for load balancing, but keep the blocks large enough,
+	// since each block keeps its own counts and material runs.
+	const size_t minBlockSize = 1 << 20;
+	size_t size = data.size() - 1;
+	size_t blockCount = size / minBlockSize;
+	size_t maxBlocks = size_t(ParallelThreadCount()) * 4;
+	if ( blockCount > maxBlocks ) blockCount = maxBlocks;
+	if ( blockCount < 1 ) blockCount = 1;
+	const char *fileEnd = data.data() + size;
+	const char *p = data.data();
+	blocks.resize( blockCount );
+	size_t n = 0;
+	for ( size_t b=0; b<blockCount && p<fileEnd; b++ ) {
+		const char *e = data.data() + size * (b+1) / blockCount;
+		if ( e < p ) e = p;
+		e = ObjNextLine( e, fileEnd );
+		blocks[n].begin = p;
+		blocks[n].end   = e;
+		n++;
+		p = e;
 	}
-	int faceFormat = ((nvn>0)<<1) | (nvt>0);
-	switch ( faceFormat ) {
-	case 0:
-		for ( unsigned int i=0; i<nf; i++ ) {
-			fprintf(fp,"f %d %d %d\n", f[i].v[0]+1, f[i].v[1]+1, f[i].v[2]+1);
+	if ( n == 0 ) { blocks[0].begin = blocks[0].end = p; n = 1; }
+	blocks.resize( n );
+}
+
+inline TriMesh::ObjLineType TriMesh::ObjGetLineType( const char *&p )
+{
+	p = ObjSkipSpace(p);
+	switch ( p[0] ) {
+		case 'v':
+			if ( ObjIsSpace(p[1]) ) { p+=1; return OBJ_V; }
+			if ( p[1]=='t' && ObjIsSpace(p[2]) ) { p+=2; return OBJ_VT; }
+			if ( p[1]=='n' && ObjIsSpace(p[2]) ) { p+=2; return OBJ_VN; }
+			break;
+		case 'f':
+			if ( ObjIsSpace(p[1]) ) { p+=1; return OBJ_F; }
+			break;
+		case 'u':
+			if ( strncmp(p,"usemtl",6)==0 && ( ObjIsSpace(p[6]) || p[6]=='\n' || p[6]=='\r' || p[6]=='\0' ) ) { p+=6; return OBJ_USEMTL; }
+			break;
+		case 'm':
+			if ( strncmp(p,"mtllib",6)==0 && ObjIsSpace(p[6]) ) { p+=6; return OBJ_MTLLIB; }
+			break;
+	}
+	return OBJ_OTHER;
+}
+
+inline TriMesh::ObjName TriMesh::ObjParseName( const char *p )
+{
+	p = ObjSkipSpace(p);
+	const char *e = p;
+	while ( *e!='\n' && *e!='\r' && *e!='\0' ) e++;
+	while ( e>p && ObjIsSpace(e[-1]) ) e--;
+	ObjName name = { p, (unsigned int)(e-p) };
+	return name;
+}
+
+inline const char* TriMesh::ObjParseInt( const char *p, int &i )
+{
+	bool negative = *p=='-';
+	if ( *p=='-' || *p=='+' ) p++;
+	int n = 0;
+	while ( *p>='0' && *p<='9' ) n = n*10 + (*p++ - '0');
+	i = negative ? -n : n;
+	return p;
+}
+
+inline const char* TriMesh::ObjParseFloat( const char *p, float &f )
+{
+	// Decimal numbers with up to 15 significant digits and small exponents are converted exactly
+	// using a single multiplication or division in double precision. Other numbers use strtof.
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char *start = p;
+	bool negative = *p=='-';
+	if ( *p=='-' || *p=='+' ) p++;
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool hasDigits = false;
+	for ( ; *p>='0' && *p<='9'; p++ ) {
+		hasDigits = true;
+		if ( digits < 19 ) { mantissa = mantissa*10 + (*p-'0'); if ( mantissa ) digits++; }
+		else exponent++;
+	}
+	if ( *p == '.' ) {
+		for ( p++; *p>='0' && *p<='9'; p++ ) {
+			hasDigits = true;
+			if ( digits < 19 ) { mantissa = mantissa*10 + (*p-'0'); if ( mantissa ) digits++; exponent--; }
 		}
-		break;
-	case 1:
-		for ( unsigned int i=0; i<nf; i++ ) {
-			fprintf(fp,"f %d/%d %d/%d %d/%d\n", f[i].v[0]+1, ft[i].v[0]+1, f[i].v[1]+1, ft[i].v[1]+1, f[i].v[2]+1, ft[i].v[2]+1);
+	}
+	if ( hasDigits && ( *p=='e' || *p=='E' ) ) {
+		const char *e = p+1;
+		bool negativeExp = *e=='-';
+		if ( *e=='-' || *e=='+' ) e++;
+		if ( *e>='0' && *e<='9' ) {
+			int exp = 0;
+			for ( ; *e>='0' && *e<='9'; e++ ) if ( exp < 100000 ) exp = exp*10 + (*e-'0');
+			exponent += negativeExp ? -exp : exp;
+			p = e;
 		}
-		break;
-	case 2:
-		for ( unsigned int i=0; i<nf; i++ ) {
-			fprintf(fp,"f %d//%d %d//%d %d//%d\n", f[i].v[0]+1, fn[i].v[0]+1, f[i].v[1]+1, fn[i].v[1]+1, f[i].v[2]+1, fn[i].v[2]+1);
+	}
+	if ( ! hasDigits ) {
+		// not a decimal number (such as inf or nan) or no number at all
+		char *e;
+		f = strtof( start, &e );
+		return e;
+	}
+	if ( mantissa <= (uint64_t(1)<<53) && exponent >= -22 && exponent <= 22 ) {
+		double d = exponent < 0 ? double(mantissa) / pow10[-exponent] : double(mantissa) * pow10[exponent];
+		// The double value is correctly rounded. Converting it to float is also correct, unless it falls
+		// exactly halfway between two floats or it is out of the normalized float range.
+		uint64_t bits;
+		memcpy( &bits, &d, sizeof(bits) );
+		if ( ( bits & 0x1FFFFFFF ) != 0x10000000 && ( d == 0 || ( d >= 1.1754943508222875e-38 && d <= 3.4028234663852886e+38 ) ) ) {
+			f = negative ? -float(d) : float(d);
+			return p;
 		}
-		break;
-	case 3:
-		for ( unsigned int i=0; i<nf; i++ ) {
-			fprintf(fp,"f %d/%d/%d %d/%d/%d %d/%d/%d\n", f[i].v[0]+1, ft[i].v[0]+1, fn[i].v[0]+1, f[i].v[1]+1, ft[i].v[1]+1, fn[i].v[1]+1, f[i].v[2]+1, ft[i].v[2]+1, fn[i].v[2]+1);
+	}
+	char *e;
+	f = strtof( start, &e );
+	return e;
+}
+
+inline void TriMesh::ObjCountBlock( ObjBlock &block, bool loadMtl )
+{
+	block.nv = block.nvt = block.nvn = block.nf = 0;
+	block.runs.clear();
+	block.mtlLibs.clear();
+	ObjRun run = { { NULL, 0 }, -1, 0, 0 };
+	block.runs.push_back( run );
+	for ( const char *p = block.begin; p < block.end; p = ObjNextLine(p,block.end) ) {
+		switch ( ObjGetLineType(p) ) {
+			case OBJ_V:  block.nv++;  break;
+			case OBJ_VT: block.nvt++; break;
+			case OBJ_VN: block.nvn++; break;
+			case OBJ_F: {
+				unsigned int n = 0;
+				for (;;) {
+					p = ObjSkipSpace(p);
+					if ( ! ObjIsIndex(*p) ) break;
+					n++;
+					while ( *p && ! ObjIsSpace(*p) && *p!='\n' && *p!='\r' ) p++;
+				}
+				if ( n > 2 ) {
+					block.nf += n-2;
+					block.runs.back().faceCount += n-2;
+				}
+				break;
+			}
+			case OBJ_USEMTL:
+				if ( loadMtl ) {
+					run.mtl = ObjParseName(p);
+					block.runs.push_back( run );
+				}
+				break;
+			case OBJ_MTLLIB:
+				if ( loadMtl ) block.mtlLibs.push_back( ObjParseName(p) );
+				break;
+			default: break;
 		}
-		break;
 	}
+}
+
+inline void TriMesh::ObjParseBlock( const ObjBlock &block, bool loadMtl, unsigned int vBase, unsigned int vtBase, unsigned int vnBase )
+{
+	// The vertex arrays begin with the vertices at the given base indices
+	unsigned int iv=block.v0, ivt=block.vt0, ivn=block.vn0;
+	size_t run = 0;
+	unsigned int fi = block.runs[0].firstFace;
+	for ( const char *p = block.begin; p < block.end; p = ObjNextLine(p,block.end) ) {
+		ObjLineType type = ObjGetLineType(p);
+		switch ( type ) {
+			case OBJ_V:
+			case OBJ_VT:
+			case OBJ_VN: {
+				float xyz[3] = { 0, 0, 0 };
+				for ( int j=0; j<3; j++ ) {
+					p = ObjSkipSpace(p);
+					if ( *p=='\n' || *p=='\r' || *p=='\0' ) break;
+					p = ObjParseFloat( p, xyz[j] );
+					while ( *p && ! ObjIsSpace(*p) && *p!='\n' && *p!='\r' ) p++;
+				}
+				Point3f &vertex = type==OBJ_V ? v[(iv++)-vBase] : ( type==OBJ_VT ? vt[(ivt++)-vtBase] : vn[(ivn++)-vnBase] );
+				vertex.Set( xyz[0], xyz[1], xyz[2] );
+				break;
+			}
+			case OBJ_F: {
+				// Faces with more than three vertices are converted to a triangle fan
+				TriFace face, textureFace, normalFace;
+				unsigned int n = 0;
+				for (;;) {
+					p = ObjSkipSpace(p);
+					if ( ! ObjIsIndex(*p) ) break;
+					int vi=0, ti=0, ni=0;
+					p = ObjParseInt( p, vi );
+					if ( *p == '/' ) {
+						p++;
+						if ( *p != '/' ) p = ObjParseInt( p, ti );
+						if ( *p == '/' ) p = ObjParseInt( p+1, ni );
+					}
+					while ( *p && ! ObjIsSpace(*p) && *p!='\n' && *p!='\r' ) p++;
+					unsigned int j = n < 2 ? n : 2;
+					face.v[j]        = ObjIndex( vi, iv  );
+					textureFace.v[j] = ObjIndex( ti, ivt );
+					normalFace.v[j]  = ObjIndex( ni, ivn );
+					if ( n >= 2 ) {
+						f[fi] = face;
+						face.v[1] = face.v[2];
+						if ( ft ) { ft[fi] = textureFace; textureFace.v[1] = textureFace.v[2]; }
+						if ( fn ) { fn[fi] = normalFace;  normalFace.v[1]  = normalFace.v[2];  }
+						fi++;
+					}
+					n++;
+				}
+				break;
+			}
+			case OBJ_USEMTL:
+				if ( loadMtl ) fi = block.runs[++run].firstFace;
+				break;
+			default: break;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------
+
+inline bool TriMesh::StreamFromFileObj( const char *filename, ObjStreamCallbacks &callbacks, size_t bufferSize )
+{
+	FILE *fp = fopen(filename,"rb");
+	if ( !fp ) return false;
+	if ( bufferSize < 4096 ) bufferSize = 4096;
+
+	std::vector<char> data, carry;
+	std::vector<ObjBlock> blocks;
+	TriMesh chunk;		// keeps the parsed data of a chunk
+	unsigned int nft=0, nfn=0;
+	uint64_t numV=0, numVT=0, numVN=0, numF=0;
+	bool eof = false;
+	while ( ! eof ) {
+		// Read the next chunk after the incomplete line of the previous chunk
+		size_t n = carry.size();
+		data.resize( n + bufferSize + 1 );
+		if ( n > 0 ) memcpy( data.data(), carry.data(), n );
+		size_t r = fread( data.data()+n, 1, bufferSize, fp );
+		if ( r < bufferSize ) {
+			if ( ferror(fp) ) { fclose(fp); return false; }
+			eof = true;
+		}
+		n += r;
+
+		// Keep the incomplete last line for the next chunk. A line that is longer than the buffer
+		// is carried until it is complete.
+		size_t end = n;
+		if ( ! eof ) while ( end > 0 && data[end-1]!='\n' && data[end-1]!='\r' ) end--;
+		carry.assign( data.begin()+end, data.begin()+n );
+		if ( end == 0 ) continue;
+		data.resize( end+1 );
+		data[end] = '\0';	// the parser relies on the terminating zero
+
+		// Count the items of the blocks in parallel
+		ObjSplitBlocks( data, blocks );
+		int blockCount = (int) blocks.size();
+		ParallelForRanges( 0, blockCount, blockCount, [&]( int, int blockBegin, int blockEnd ) {
+			for ( int b=blockBegin; b<blockEnd; b++ ) ObjCountBlock( blocks[b], true );
+		} );
+
+		// Place the blocks and their material runs in file order
+		uint64_t cnv=0, cnvt=0, cnvn=0, cnf=0;
+		for ( int b=0; b<blockCount; b++ ) {
+			ObjBlock &block = blocks[b];
+			block.v0  = (unsigned int)( numV  + cnv  );
+			block.vt0 = (unsigned int)( numVT + cnvt );
+			block.vn0 = (unsigned int)( numVN + cnvn );
+			cnv += block.nv;
+			cnvt += block.nvt;
+			cnvn += block.nvn;
+			for ( size_t i=0; i<block.runs.size(); i++ ) {
+				block.runs[i].firstFace = (unsigned int) cnf;
+				cnf += block.runs[i].faceCount;
+			}
+		}
+		if ( numV+cnv > 0xFFFFFFFFu || numVT+cnvt > 0xFFFFFFFFu || numVN+cnvn > 0xFFFFFFFFu || cnf > 0xFFFFFFFFu ) { fclose(fp); return false; }
+		chunk.Allocate( (unsigned int) cnv,  chunk.v,  chunk.nv  );
+		chunk.Allocate( (unsigned int) cnvt, chunk.vt, chunk.nvt );
+		chunk.Allocate( (unsigned int) cnvn, chunk.vn, chunk.nvn );
+		chunk.Allocate( (unsigned int) cnf,  chunk.f,  chunk.nf  );
+		chunk.Allocate( numVT+cnvt > 0 ? (unsigned int) cnf : 0, chunk.ft, nft );
+		chunk.Allocate( numVN+cnvn > 0 ? (unsigned int) cnf : 0, chunk.fn, nfn );
 
+		// Parse the blocks in parallel
+		ParallelForRanges( 0, blockCount, blockCount, [&]( int, int blockBegin, int blockEnd ) {
+			for ( int b=blockBegin; b<blockEnd; b++ ) chunk.ObjParseBlock( blocks[b], true, (unsigned int) numV, (unsigned int) numVT, (unsigned int) numVN );
+		} );
+
+		// Pass the data to the callbacks
+		bool ok = true;
+		for ( int b=0; b<blockCount && ok; b++ ) {
+			for ( size_t i=0; i<blocks[b].mtlLibs.size() && ok; i++ ) {
+				std::string name( blocks[b].mtlLibs[i].str, blocks[b].mtlLibs[i].len );
+				ok = callbacks.MaterialLibrary( name.c_str() );
+			}
+		}
+		if ( ok && cnv  > 0 ) ok = callbacks.Vertices( chunk.v,  (unsigned int) cnv,  numV  );
+		if ( ok && cnvt > 0 ) ok = callbacks.TexVerts( chunk.vt, (unsigned int) cnvt, numVT );
+		if ( ok && cnvn > 0 ) ok = callbacks.Normals ( chunk.vn, (unsigned int) cnvn, numVN );
+		for ( int b=0; b<blockCount && ok; b++ ) {
+			for ( size_t i=0; i<blocks[b].runs.size() && ok; i++ ) {
+				const ObjRun &run = blocks[b].runs[i];
+				if ( i > 0 ) {
+					std::string name( run.mtl.str, run.mtl.len );
+					ok = callbacks.Material( name.c_str(), numF + run.firstFace );
+				}
+				if ( ok && run.faceCount > 0 ) {
+					unsigned int fi = run.firstFace;
+					ok = callbacks.Faces( chunk.f + fi, chunk.ft ? chunk.ft + fi : NULL, chunk.fn ? chunk.fn + fi : NULL, run.faceCount, numF + fi );
+				}
+			}
+		}
+		if ( ! ok ) { fclose(fp); return false; }
+		numV  += cnv;
+		numVT += cnvt;
+		numVN += cnvn;
+		numF  += cnf;
+	}
 	fclose(fp);
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+
+inline bool TriMesh::SaveToFileObj( const char *filename, int precision )
+{
+	FILE *fp = fopen(filename,"w");
+	if ( !fp ) return false;
+
+	auto WriteVertex = [precision]( char *p, const char *type, const Point3f &vertex ) {
+		while ( *type ) *p++ = *type++;
+		for ( int j=0; j<3; j++ ) {
+			*p++ = ' ';
+			p = ObjWriteFloat( p, vertex[j], precision );
+		}
+		*p++ = '\n';
+		return p;
+	};
+	// The shortest representation needs at most 16 characters. With a given precision, a number is written
+	// with at most 16 significant digits, or as "-0." followed by the digits after the decimal point.
+	// Precisions above 22 fall back to the shortest representation.
+	const int maxFloatLength = precision < 0 ? 17 : 3 + ( precision < 15 ? 15 : precision < 22 ? precision : 22 );
+	const size_t maxVertexLine = 3 + 3*( 1 + maxFloatLength );
+	bool ok = ObjWriteLines( fp, nv,  maxVertexLine, [&]( char *p, unsigned int i ) { return WriteVertex( p, "v",  v [i] ); } )
+	       && ObjWriteLines( fp, nvt, maxVertexLine, [&]( char *p, unsigned int i ) { return WriteVertex( p, "vt", vt[i] ); } )
+	       && ObjWriteLines( fp, nvn, maxVertexLine, [&]( char *p, unsigned int i ) { return WriteVertex( p, "vn", vn[i] ); } );
+
+	const bool hasTexture = nvt > 0, hasNormal = nvn > 0;
+	ok = ok && ObjWriteLines( fp, nf, 2 + 3*3*12, [&]( char *p, unsigned int i ) {
+		*p++ = 'f';
+		for ( int j=0; j<3; j++ ) {
+			*p++ = ' ';
+			p = ObjWriteUInt( p, uint64_t(f[i].v[j]) + 1 );
+			if ( hasTexture || hasNormal ) {
+				*p++ = '/';
+				if ( hasTexture ) p = ObjWriteUInt( p, uint64_t(ft[i].v[j]) + 1 );
+				if ( hasNormal ) { *p++ = '/'; p = ObjWriteUInt( p, uint64_t(fn[i].v[j]) + 1 ); }
+			}
+		}
+		*p++ = '\n';
+		return p;
+	} );
+
+	if ( fclose(fp) != 0 ) ok = false;
+
+	return ok;
+}
+
+inline char* TriMesh::ObjWriteFloat( char *p, float f, int precision )
+{
+	if ( f != f ) { memcpy( p, "nan", 3 ); return p+3; }
+	uint32_t bits;
+	memcpy( &bits, &f, sizeof(bits) );
+	if ( bits >> 31 ) { *p++ = '-'; f = -f; }
+	if ( f == 0 ) { *p++ = '0'; return p; }
+	if ( f > 3.4028234663852886e+38 ) { memcpy( p, "inf", 3 ); return p+3; }
+
+	// Find the decimal digits and the exponent, such that the value is digits * 10^exponent
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const double d = f;
+	uint64_t digits = 0;
+	int exponent = 0;
+	bool found = false;
+	if ( precision >= 0 ) {
+		if ( precision <= 22 && d * pow10[precision] < 9007199254740992.0 ) {
+			digits = (uint64_t)( d * pow10[precision] + 0.5 );
+			exponent = -precision;
+			found = true;
+		}
+	} else {
+		// Try the nearest decimal numbers with increasing number of significant digits. A candidate is
+		// converted back exactly as in ObjParseFloat, so it is accepted only if it reads back to the same value.
+		int e10 = (int) cyFloor( log10(d) );
+		for ( int n=1; n<=9; n++ ) {
+			int k = e10 - n + 1;
+			if ( k < -22 || k > 22 ) break;
+			uint64_t c = (uint64_t)( ( k < 0 ? d * pow10[-k] : d / pow10[k] ) + 0.5 );
+			double r = k < 0 ? double(c) / pow10[-k] : double(c) * pow10[k];
+			uint64_t rbits;
+			memcpy( &rbits, &r, sizeof(rbits) );
+			bool exact = k >= 0 && r <= 9007199254740992.0;	// an integer product is exact, so converting it to float is correct
+			if ( float(r) == f && ( exact || ( rbits & 0x1FFFFFFF ) != 0x10000000 ) && r >= 1.1754943508222875e-38 ) {
+				digits = c;
+				exponent = k;
+				found = true;
+				break;
+			}
+		}
+	}
+	if ( ! found ) {
+		// Very large or very small numbers use the standard library
+		char s[32];
+		for ( int n=1; n<=9; n++ ) {
+			snprintf( s, sizeof(s), "%.*g", n, d );
+			if ( strtof( s, NULL ) == f ) break;
+		}
+		size_t len = strlen(s);
+		memcpy( p, s, len );
+		return p + len;
+	}
+	if ( digits == 0 ) { *p++ = '0'; return p; }
+	while ( digits % 10 == 0 ) { digits /= 10; exponent++; }
 
+	char s[20];
+	int n = 0;
+	for ( uint64_t i=digits; i; i/=10 ) s[n++] = char( '0' + i%10 );	// reversed digits
+	int e = n - 1 + exponent;	// the exponent in scientific notation
+	if ( precision < 0 && ( e < -5 || e > 8 ) ) {
+		*p++ = s[--n];
+		if ( n > 0 ) { *p++ = '.'; while ( n > 0 ) *p++ = s[--n]; }
+		*p++ = 'e';
+		if ( e < 0 ) { *p++ = '-'; e = -e; }
+		return ObjWriteUInt( p, uint64_t(e) );
+	}
+	if ( exponent >= 0 ) {
+		while ( n > 0 ) *p++ = s[--n];
+		for ( int i=0; i<exponent; i++ ) *p++ = '0';
+	} else if ( n + exponent > 0 ) {
+		for ( int i=n+exponent; i>0; i-- ) *p++ = s[--n];
+		*p++ = '.';
+		while ( n > 0 ) *p++ = s[--n];
+	} else {
+		*p++ = '0';
+		*p++ = '.';
+		for ( int i=n+exponent; i<0; i++ ) *p++ = '0';
+		while ( n > 0 ) *p++ = s[--n];
+	}
+	return p;
+}
+
+template <typename FORMAT>
+inline bool TriMesh::ObjWriteLines( FILE *fp, unsigned int count, size_t maxLineLength, FORMAT format )
+{
+	// The lines are formatted into chunks in parallel, and the chunks are written in order.
+	// A few chunks per thread are kept in memory at a time.
+	const unsigned int chunkSize = 1 << 14;
+	const unsigned int chunkCount = ( count + chunkSize - 1 ) / chunkSize;
+	const unsigned int roundSize = (unsigned int) ParallelThreadCount() * 2;
+	std::vector< std::vector<char> > buffers( roundSize < chunkCount ? roundSize : chunkCount );
+	std::vector<size_t> sizes( buffers.size() );
+	for ( unsigned int c0=0; c0<chunkCount; c0+=roundSize ) {
+		int n = (int)( chunkCount-c0 < roundSize ? chunkCount-c0 : roundSize );
+		ParallelForRanges( 0, n, n, [&]( int, int chunkBegin, int chunkEnd ) {
+			for ( int c=chunkBegin; c<chunkEnd; c++ ) {
+				unsigned int first = ( c0 + c ) * chunkSize;
+				unsigned int last = count - first < chunkSize ? count : first + chunkSize;
+				buffers[c].resize( size_t(chunkSize) * maxLineLength );
+				char *p = buffers[c].data();
+				for ( unsigned int i=first; i<last; i++ ) p = format( p, i );
+				sizes[c] = p - buffers[c].data();
+			}
+		} );
+		for ( int c=0; c<n; c++ ) {
+			if ( fwrite( buffers[c].data(), 1, sizes[c], fp ) != sizes[c] ) return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------
+
+inline bool TriMesh::SaveBinary( const char *filename, int64_t sourceTime, uint64_t sourceSize, bool loadMtl ) const
+{
+	BinaryHeader header;
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.id, "CYTRIMSH", 8 );
+	header.version   = BINARY_VERSION;
+	header.byteOrder = 0x01020304;
+	header.mtlSize   = sizeof(Mtl);
+	header.flags     = ( fn ? BINARY_HAS_FN : 0 ) | ( ft ? BINARY_HAS_FT : 0 ) | ( loadMtl ? BINARY_LOAD_MTL : 0 );
+	header.nv  = nv;
+	header.nf  = nf;
+	header.nvn = nvn;
+	header.nvt = nvt;
+	header.nm  = nm;
+	boundMin.Get( header.boundMin );
+	boundMax.Get( header.boundMax );
+	header.sourceTime = sourceTime;
+	header.sourceSize = sourceSize;
+
+	const void *arrays[BINARY_ARRAY_COUNT] = { v, f, vn, fn, vt, ft, m, mcfc };
+	const uint64_t sizes[BINARY_ARRAY_COUNT] = {
+		uint64_t(nv)*sizeof(Point3f), uint64_t(nf)*sizeof(TriFace), uint64_t(nvn)*sizeof(Point3f), fn ? uint64_t(nf)*sizeof(TriFace) : 0,
+		uint64_t(nvt)*sizeof(Point3f), ft ? uint64_t(nf)*sizeof(TriFace) : 0, uint64_t(nm)*sizeof(Mtl), uint64_t(nm)*sizeof(int) };
+	uint64_t offset = sizeof(BinaryHeader);
+	for ( int i=0; i<BINARY_ARRAY_COUNT; i++ ) {
+		if ( sizes[i] == 0 || arrays[i] == NULL ) continue;
+		offset = ( offset + BINARY_ALIGNMENT-1 ) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+		header.offset[i] = offset;
+		offset += sizes[i];
+	}
+	header.fileSize = offset;
+
+	FILE *fp = fopen(filename,"wb");
+	if ( !fp ) return false;
+	bool ok = fwrite( &header, sizeof(header), 1, fp ) == 1;
+	uint64_t pos = sizeof(BinaryHeader);
+	const char padding[BINARY_ALIGNMENT] = {};
+	for ( int i=0; i<BINARY_ARRAY_COUNT && ok; i++ ) {
+		if ( header.offset[i] == 0 ) continue;
+		size_t pad = size_t( header.offset[i] - pos );
+		ok = ( pad == 0 || fwrite( padding, 1, pad, fp ) == pad ) && fwrite( arrays[i], 1, size_t(sizes[i]), fp ) == sizes[i];
+		pos = header.offset[i] + sizes[i];
+	}
+	if ( fclose(fp) != 0 ) ok = false;
+	if ( !ok ) remove( filename );	// do not leave a partial file behind
+	return ok;
+}
+
+inline bool TriMesh::LoadBinary( const char *filename, bool useMemoryMapping, const int64_t *sourceTime, uint64_t sourceSize, bool loadMtl )
+{
+	// Get the file data, either by mapping the file or by reading it
+	MappedFile file;
+	std::vector<char> buffer;
+	const char *data;
+	size_t size;
+	if ( useMemoryMapping ) {
+		if ( ! file.Open( filename ) ) return false;
+		data = file.Data();
+		size = file.Size();
+	} else {
+		if ( ! ReadFile( filename, buffer ) ) return false;
+		data = buffer.data();
+		size = buffer.size() - 1;
+	}
+
+	// Check the header
+	if ( size < sizeof(BinaryHeader) ) return false;
+	BinaryHeader header;
+	memcpy( &header, data, sizeof(header) );
+	if ( memcmp( header.id, "CYTRIMSH", 8 ) != 0 || header.version != BINARY_VERSION || header.byteOrder != 0x01020304 || header.mtlSize != sizeof(Mtl) ) return false;
+	if ( header.fileSize != size ) return false;
+	if ( sourceTime && ( header.sourceTime != *sourceTime || header.sourceSize != sourceSize || ( (header.flags & BINARY_LOAD_MTL) != 0 ) != loadMtl ) ) return false;
+	const uint64_t sizes[BINARY_ARRAY_COUNT] = {
+		uint64_t(header.nv)*sizeof(Point3f), uint64_t(header.nf)*sizeof(TriFace), uint64_t(header.nvn)*sizeof(Point3f), ( header.flags & BINARY_HAS_FN ) ? uint64_t(header.nf)*sizeof(TriFace) : 0,
+		uint64_t(header.nvt)*sizeof(Point3f), ( header.flags & BINARY_HAS_FT ) ? uint64_t(header.nf)*sizeof(TriFace) : 0, uint64_t(header.nm)*sizeof(Mtl), uint64_t(header.nm)*sizeof(int) };
+	for ( int i=0; i<BINARY_ARRAY_COUNT; i++ ) {
+		if ( sizes[i] == 0 ) continue;
+		if ( header.offset[i] < sizeof(BinaryHeader) || header.offset[i] % BINARY_ALIGNMENT != 0 || header.offset[i] > size || sizes[i] > size - header.offset[i] ) return false;
+	}
+
+	Clear();
+	boundMin.Set( header.boundMin[0], header.boundMin[1], header.boundMin[2] );
+	boundMax.Set( header.boundMax[0], header.boundMax[1], header.boundMax[2] );
+	nv  = header.nv;
+	nf  = header.nf;
+	nvn = header.nvn;
+	nvt = header.nvt;
+	nm  = header.nm;
+	void **arrays[BINARY_ARRAY_COUNT] = { (void**)&v, (void**)&f, (void**)&vn, (void**)&fn, (void**)&vt, (void**)&ft, (void**)&m, (void**)&mcfc };
+	if ( useMemoryMapping ) {
+		// Point the arrays into the mapped file and keep the mapping
+		for ( int i=0; i<BINARY_ARRAY_COUNT; i++ ) *arrays[i] = sizes[i] > 0 ? file.Data() + header.offset[i] : NULL;
+		mappedFile.Swap( file );
+	} else {
+		if ( nv  > 0 ) v  = new Point3f[nv];
+		if ( nf  > 0 ) f  = new TriFace[nf];
+		if ( nvn > 0 ) vn = new Point3f[nvn];
+		if ( nvt > 0 ) vt = new Point3f[nvt];
+		if ( nm  > 0 ) { m = new Mtl[nm]; mcfc = new int[nm]; }
+		if ( sizes[BINARY_FN] > 0 ) fn = new TriFace[nf];
+		if ( sizes[BINARY_FT] > 0 ) ft = new TriFace[nf];
+		for ( int i=0; i<BINARY_ARRAY_COUNT; i++ ) if ( sizes[i] > 0 ) memcpy( *arrays[i], data + header.offset[i], size_t(sizes[i]) );
+	}
 	return true;
 }
 
@@ -0,0 +1,212 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyVertexWeld.h
+//! \author Cem Yuksel
+//!
+//! \brief  Vertex welding using a parallel spatial hash.
+//!
+//! This file includes a function that finds the points that are within a
+//! given distance of each other and maps them to a single point. It can be
+//! used for merging duplicate mesh vertices.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_VERTEX_WELD_H_INCLUDED_
+#define _CY_VERTEX_WELD_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyCore.h"
+#include "cyPoint.h"
+#include "cyIPoint.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Welds the given points and returns the number of unique points.
+//!
+//! Each point is mapped to the point with the smallest index within the given tolerance distance,
+//! and the mapping is followed until it reaches a point that is not mapped to another point.
+//! Therefore, points that form a chain with distances below the tolerance may be merged, even if
+//! the distance between the two ends of the chain is larger. The unique points are numbered in
+//! the order of their first appearance and remap[i] receives the new index of point i.
+//! The remap array must have at least count elements. If the tolerance is zero (or negative),
+//! only the points with exactly the same coordinates are merged.
+//!
+//! The points are placed in the cells of a uniform grid with twice the tolerance as the cell size,
+//! so that the points within the tolerance distance are in one of eight neighboring cells.
+//! The cells are identified by quantized IPoint3 keys and they are found using a hash table
+//! that is built in parallel. The result does not depend on the number of threads.
+
+template <typename TYPE, typename SIZE_TYPE>
+inline SIZE_TYPE WeldPoints( const Point3<TYPE> *points, SIZE_TYPE count, TYPE tolerance, SIZE_TYPE *remap )
+{
+	if ( count == 0 ) return 0;
+	const bool exact = !( tolerance > 0 );
+
+	// Compute the cell of each point. In exact mode, the cell is the bit pattern of the point.
+	struct Entry { IPoint3i cell; SIZE_TYPE index; };
+	std::vector<Entry> entries( count );
+	const TYPE cellScale = exact ? TYPE(1) : TYPE(0.5) / tolerance;
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE i ) {
+		const Point3<TYPE> &p = points[i];
+		int32_t b[3];
+		if ( exact ) {
+			float c[3] = { float(p.x) + 0.0f, float(p.y) + 0.0f, float(p.z) + 0.0f };	// adding zero converts -0 to +0
+			memcpy( b, c, sizeof(b) );
+		} else {
+			const TYPE c[3] = { p.x * cellScale, p.y * cellScale, p.z * cellScale };
+			for ( int j=0; j<3; j++ ) {
+				TYPE f = cyFloor( c[j] );
+				b[j] = f >= TYPE(INT32_MAX) ? INT32_MAX : ( f > TYPE(INT32_MIN) ? int32_t(f) : INT32_MIN );
+			}
+		}
+		entries[i].cell.Set( b[0], b[1], b[2] );
+		entries[i].index = i;
+	} );
+
+	// Sort the points by their cells, keeping the points of each cell in index order,
+	// and keep a sorted copy of the points, so that the points of a cell are accessed sequentially.
+	ParallelSort( entries.begin(), entries.end(), []( const Entry &a, const Entry &b ) {
+		if ( a.cell.x != b.cell.x ) return a.cell.x < b.cell.x;
+		if ( a.cell.y != b.cell.y ) return a.cell.y < b.cell.y;
+		if ( a.cell.z != b.cell.z ) return a.cell.z < b.cell.z;
+		return a.index < b.index;
+	} );
+	std::vector<Point3<TYPE>> sorted( count );
+	ParallelFor( SIZE_TYPE(0), count, [&]( SIZE_TYPE j ) { sorted[j] = points[ entries[j].index ]; } );
+
+	// Find the first point of each cell in the sorted order
+	std::vector<SIZE_TYPE> cellStart;
+	cellStart.reserve( count/2 + 2 );
+	for ( SIZE_TYPE j=0; j<count; j++ ) {
+		if ( j == 0 || entries[j].cell != entries[j-1].cell ) cellStart.push_back( j );
+	}
+	const SIZE_TYPE cellCount = SIZE_TYPE( cellStart.size() );
+	cellStart.push_back( count );
+
+	// Build a hash table of the cells with open addressing. The slots keep the cell keys,
+	// so that finding a cell usually accesses a single slot. In exact mode, the points
+	// can only be merged with the points in the same cell, so the table is not needed.
+	struct Slot { IPoint3i key; std::atomic<SIZE_TYPE> cell; };
+	const SIZE_TYPE EMPTY = SIZE_TYPE(-1);
+	size_t tableSize = 0;
+	if ( ! exact ) {
+		tableSize = 1;
+		while ( tableSize < size_t(cellCount)*2 ) tableSize *= 2;
+	}
+	const size_t tableMask = tableSize - 1;
+	std::unique_ptr<Slot[]> table( new Slot[tableSize] );
+	auto CellHash = []( const IPoint3i &c ) {
+		uint64_t h = uint64_t(uint32_t(c.x)) * 0x9E3779B97F4A7C15ull;
+		h ^= uint64_t(uint32_t(c.y)) * 0xC2B2AE3D27D4EB4Full;
+		h ^= uint64_t(uint32_t(c.z)) * 0x165667B19E3779F9ull;
+		h ^= h >> 33;	// mix the high bits into the low bits used by the table
+		h *= 0xFF51AFD7ED558CCDull;
+		return h ^ (h >> 33);
+	};
+	ParallelFor( size_t(0), tableSize, [&]( size_t i ) { table[i].cell.store( EMPTY, std::memory_order_relaxed ); } );
+	if ( ! exact ) {
+		ParallelFor( SIZE_TYPE(0), cellCount, [&]( SIZE_TYPE c ) {
+			const IPoint3i &key = entries[ cellStart[c] ].cell;
+			for ( size_t slot = CellHash(key) & tableMask; ; slot = (slot+1) & tableMask ) {
+				SIZE_TYPE expected = EMPTY;
+				if ( table[slot].cell.compare_exchange_strong( expected, c, std::memory_order_relaxed ) ) { table[slot].key = key; break; }
+			}
+		} );
+	}
+	auto FindCell = [&]( const IPoint3i &key ) {
+		for ( size_t slot = CellHash(key) & tableMask; ; slot = (slot+1) & tableMask ) {
+			SIZE_TYPE c = table[slot].cell.load( std::memory_order_relaxed );
+			if ( c == EMPTY || table[slot].key == key ) return c;
+		}
+	};
+
+	// Map each point to the point with the smallest index within the tolerance.
+	// The neighboring cells are found when they are first needed by a point of the cell
+	// and they are shared by the other points of the cell.
+	const TYPE tolerance2 = tolerance * tolerance;
+	const SIZE_TYPE UNKNOWN = EMPTY - 1;
+	ParallelFor( SIZE_TYPE(0), cellCount, [&]( SIZE_TYPE c ) {
+		const IPoint3i &cell = entries[ cellStart[c] ].cell;
+		const int32_t b[3] = { cell.x, cell.y, cell.z };
+		SIZE_TYPE neighbors[27];	// indexed by (z+1)*9 + (y+1)*3 + (x+1)
+		if ( ! exact ) for ( int n=0; n<27; n++ ) neighbors[n] = UNKNOWN;
+		auto Neighbor = [&]( int x, int y, int z ) {
+			SIZE_TYPE &n = neighbors[ (z+1)*9 + (y+1)*3 + (x+1) ];
+			if ( n == UNKNOWN ) {
+				if ( ( x|y|z ) == 0 ) n = c;
+				else if ( ( x<0 && b[0]==INT32_MIN ) || ( x>0 && b[0]==INT32_MAX ) || ( y<0 && b[1]==INT32_MIN ) || ( y>0 && b[1]==INT32_MAX ) || ( z<0 && b[2]==INT32_MIN ) || ( z>0 && b[2]==INT32_MAX ) ) n = EMPTY;
+				else n = FindCell( IPoint3i( b[0]+x, b[1]+y, b[2]+z ) );
+			}
+			return n;
+		};
+		for ( SIZE_TYPE j=cellStart[c]; j<cellStart[c+1]; j++ ) {
+			const SIZE_TYPE i = entries[j].index;
+			const Point3<TYPE> &p = sorted[j];
+			SIZE_TYPE best = i;
+			// The neighboring cell along each axis is on the side of the cell that contains the point
+			int side[3] = { 0, 0, 0 };
+			if ( ! exact ) {
+				const TYPE pc[3] = { p.x * cellScale, p.y * cellScale, p.z * cellScale };
+				for ( int k=0; k<3; k++ ) side[k] = pc[k] - TYPE(b[k]) < TYPE(0.5) ? -1 : 1;
+			}
+			for ( int z=0; z<=(side[2]!=0); z++ ) {
+				for ( int y=0; y<=(side[1]!=0); y++ ) {
+					for ( int x=0; x<=(side[0]!=0); x++ ) {
+						SIZE_TYPE nc = exact ? c : Neighbor( x*side[0], y*side[1], z*side[2] );
+						if ( nc == EMPTY ) continue;
+						for ( SIZE_TYPE k=cellStart[nc]; k<cellStart[nc+1]; k++ ) {
+							if ( entries[k].index >= best ) break;
+							const Point3<TYPE> &q = sorted[k];
+							if ( exact ? ( p.x==q.x && p.y==q.y && p.z==q.z ) : (q-p).LengthSquared() <= tolerance2 ) { best = entries[k].index; break; }
+						}
+					}
+				}
+			}
+			remap[i] = best;
+		}
+	} );
+
+	// Follow the mappings and number the unique points in the order of their first appearance.
+	// Since each point is mapped to a point with a smaller index, a single pass is sufficient.
+	SIZE_TYPE uniqueCount = 0;
+	for ( SIZE_TYPE i=0; i<count; i++ ) {
+		remap[i] = remap[i] == i ? uniqueCount++ : remap[ remap[i] ];
+	}
+	return uniqueCount;
+}
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+#endif
@@ -9,6 +9,9 @@
 #include <memory>
 
 #include "cy\cyPoint.h"
+#include "cy\cyVertexWeld.h"
+#include "cy\cySpaceFillingCurve.h"
+#include "xgeometry.h"
 
 namespace XR
 {
@@ -30,6 +33,7 @@ namespace XR
         virtual void get_face_index(std::vector<int>&, int) const = 0;
         virtual int get_face_degree(int) const = 0;
         virtual void add_face(const std::vector<int>&) = 0;
+        virtual void remap_indices(const std::vector<unsigned int>&) = 0;
     };
 
     class TriFaceStorage:
@@ -60,6 +64,17 @@ namespace XR
             }
         }
 
+        void remap_indices(const std::vector<unsigned int>& map)
+        {
+            for (auto& face : data_)
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    face[i] = map[face[i]];
+                }
+            }
+        }
+
     private:
         std::vector<int[3]> data_;
     };
@@ -97,6 +112,14 @@ namespace XR
             indices_.push_back(data_.size());
         }
 
+        void remap_indices(const std::vector<unsigned int>& map)
+        {
+            for (int& id : data_)
+            {
+                id = map[id];
+            }
+        }
+
     private:
         std::vector<int> indices_;
         std::vector<int> data_;
@@ -231,6 +254,64 @@ namespace XR
         }
     };
 
+    // Merges the vertices that are within the given distance (see cy::WeldPoints)
+    // and remaps the face indices. Returns the number of vertices after welding.
+    inline size_t weld_vertices(OffMesh& mesh, float tolerance = 0.0f)
+    {
+        if (!mesh.vertices || !mesh.faces)
+        {
+            throw std::exception("Cannot weld vertices");
+        }
+
+        VertexStorage& vertices = *mesh.vertices;
+        std::vector<unsigned int> remap(vertices.size());
+        unsigned int n = cy::WeldPoints(vertices.data(), (unsigned int)vertices.size(), tolerance, remap.data());
+
+        VertexStorage welded(n);
+        for (size_t i = vertices.size(); i-- > 0;)
+        {
+            welded[remap[i]] = vertices[i];
+        }
+        vertices.swap(welded);
+        mesh.faces->remap_indices(remap);
+        mesh.nv = n;
+        return n;
+    }
+
+    // Reorders the vertices along a space-filling curve (see cy::SpatialSortOrder) and remaps
+    // the face indices. The curve keys are computed from the vertex positions normalized with
+    // the given bounding box, so meshes sorted with the same box use the same curve.
+    inline void spatial_sort_vertices(OffMesh& mesh, const BoundingBox& bbox, cy::SpaceFillingCurve curve = cy::SFC_MORTON)
+    {
+        if (!mesh.vertices || !mesh.faces)
+        {
+            throw std::exception("Cannot sort vertices");
+        }
+
+        VertexStorage& vertices = *mesh.vertices;
+        unsigned int n = (unsigned int)vertices.size();
+        cyPoint3f bmin((float)bbox.xmin(), (float)bbox.ymin(), (float)bbox.zmin());
+        cyPoint3f bmax((float)bbox.xmax(), (float)bbox.ymax(), (float)bbox.zmax());
+        std::vector<unsigned int> order(n), remap(n);
+        cy::SpatialSortOrder(vertices.data(), n, order.data(), curve, bmin, bmax);
+        cy::InvertOrder(order.data(), n, remap.data());
+        cy::ApplyOrder(vertices.data(), n, order.data());
+        mesh.faces->remap_indices(remap);
+    }
+
+    // Reorders the vertices along a space-filling curve within their bounding box.
+    inline void spatial_sort_vertices(OffMesh& mesh, cy::SpaceFillingCurve curve = cy::SFC_MORTON)
+    {
+        if (!mesh.vertices || mesh.vertices->empty())
+        {
+            return;
+        }
+
+        cyPoint3f bmin, bmax;
+        cy::ComputeBounds(mesh.vertices->data(), mesh.vertices->size(), bmin, bmax);
+        spatial_sort_vertices(mesh, BoundingBox(bmin.x, bmin.y, bmin.z, bmax.x, bmax.y, bmax.z), curve);
+    }
+
 
 
 }